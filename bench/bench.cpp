@@ -0,0 +1,830 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Evaluate a suite of canonical workloads, exercising the main kinds
+// of operations, and report the total evaluation time of each, as
+// well as the evaluation time of each of its operations, in JSON.
+// Each workload is evaluated repeatedly and the results can be
+// compared against a baseline, i.e. the saved output of a previous
+// run, reporting workloads and operations that have become slower by
+// more than a threshold and significantly so, given the variation
+// across repetitions.  The exit status is non-zero if any workload
+// has regressed.
+//
+// Usage: bench [OPTION...] [WORKLOAD...]
+//
+//   -r N, --repetitions=N     Evaluate each workload N times (default 5).
+//   -t N, --threads=N         Use N evaluation threads.
+//   -o FILE, --output=FILE    Write the results to FILE.
+//   -b FILE, --baseline=FILE  Compare the results against FILE.
+//   --threshold=X             Report slowdowns by more than a fraction X
+//                             (default 0.1).
+//   --significance=T          Report slowdowns with a t-statistic of at
+//                             least T (default 2).
+//   -l, --list                List the workloads.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <getopt.h>
+
+#include <CGAL/assertions.h>
+
+#include "options.h"
+#include "kernel.h"
+#include "tolerances.h"
+#include "transformations.h"
+#include "cost_database.h"
+#include "macros.h"
+
+std::unordered_map<std::string, std::shared_ptr<Operation>> &_get_operations();
+
+///////////////
+// Workloads //
+///////////////
+
+// A workload builds a graph of operations in the current unit.  Its
+// set-up function, if any, is called before each evaluation and its
+// preparation function, if any, once before the first evaluation,
+// which isn't timed.  Options are reset to the defaults below before
+// each evaluation.
+
+struct Workload {
+    const char *name;
+    std::function<void()> build;
+    std::function<void()> set_up, prepare;
+};
+
+static void reset_options()
+{
+    Tolerances::curve = FT::ET(1, 100);
+    Tolerances::projection = FT::ET(1, 1'000'000);
+    Options::polyhedron_booleans = Polyhedron_booleans_mode::AUTO;
+    Flags::store_operations = 0;
+    Flags::load_operations = 0;
+    Options::store_threshold = 0;
+}
+
+// Stored operations are kept in the working directory, which is
+// emptied to get a cold store.
+
+static void clear_store()
+{
+    for (const auto &x: std::filesystem::directory_iterator(".")) {
+        std::filesystem::remove_all(x.path());
+    }
+}
+
+static void build_sphere(const int n)
+{
+    Tolerances::curve = FT::ET(1, n);
+    SPHERE(1);
+}
+
+// A star of cylinders, joined one at a time.
+
+static void build_join_chain(const int n)
+{
+    auto p = CYLINDER(FT::ET(1, 2), 8);
+
+    for (int i = 1; i < n; i++) {
+        p = JOIN(p, TRANSFORM(CYLINDER(FT::ET(1, 2), 8),
+                              basic_rotation(180.0 * i / n, 0)));
+    }
+}
+
+// A row of holes, drilled through a slab, one at a time.
+
+static void build_difference_chain(const int n)
+{
+    auto p = CUBOID(2 * n + 2, 4, 2);
+
+    for (int i = 0; i < n; i++) {
+        p = DIFFERENCE(p, TRANSFORM(CYLINDER(FT::ET(1, 2), 4),
+                                    TRANSLATION_3(2 * i - n + 1, 0, 0)));
+    }
+}
+
+static void build_extrusion(const int n)
+{
+    std::vector<Aff_transformation_3> v;
+
+    for (int i = 0; i <= n; i++) {
+        v.push_back(TRANSLATION_3(0, 0, FT(FT::ET(i, 10)))
+                    * basic_rotation(2.0 * i, 2));
+    }
+
+    EXTRUSION(REGULAR_POLYGON(8, 1), std::move(v));
+}
+
+static void build_remesh()
+{
+    REMESH(SPHERE(1), nullptr, nullptr, FT(FT::ET(1, 20)), 3);
+}
+
+static void build_deform()
+{
+    auto b = TRANSFORM(BOUNDING_HALFSPACE(1, 0, 0, 0),
+                       TRANSLATION_3(-2, 0, 0));
+
+    DEFORM(
+        REMESH(
+            CUBOID(5, 1, 1),
+            nullptr, EDGES_IN(BOUNDING_HALFSPACE(0, 0, 1, -1)),
+            FT(FT::ET(1, 4)), 1),
+        {std::pair(VERTICES_IN(b), basic_rotation(90, 0)),
+         std::pair(VERTICES_IN(TRANSFORM(b, basic_rotation(180, 1))),
+                   basic_rotation(-90, 0))},
+        FT::ET(1, 100), 1000);
+}
+
+static void build_conic_booleans(const int n)
+{
+    Tolerances::curve = FT::ET(1, 1000);
+
+    auto p = ELLIPSE(4, 1);
+
+    for (int i = 1; i < n; i++) {
+        p = JOIN(p, TRANSFORM(ELLIPSE(4, 1), basic_rotation(180.0 * i / n)));
+    }
+
+    DIFFERENCE(p, ELLIPSE(2, 1));
+}
+
+static const Workload workloads[] = {
+    {"sphere-1/10", [] {build_sphere(10);}},
+    {"sphere-1/100", [] {build_sphere(100);}},
+    {"sphere-1/1000", [] {build_sphere(1000);}},
+
+    {"join-corefine", [] {build_join_chain(16);}, [] {
+        Options::polyhedron_booleans = Polyhedron_booleans_mode::COREFINE;
+    }},
+
+    {"difference-corefine", [] {build_difference_chain(16);}, [] {
+        Options::polyhedron_booleans = Polyhedron_booleans_mode::COREFINE;
+    }},
+
+    {"join-nef", [] {build_join_chain(6);}, [] {
+        Options::polyhedron_booleans = Polyhedron_booleans_mode::NEF;
+    }},
+
+    {"difference-nef", [] {build_difference_chain(6);}, [] {
+        Options::polyhedron_booleans = Polyhedron_booleans_mode::NEF;
+    }},
+
+    {"extrusion", [] {build_extrusion(200);}},
+    {"remesh", build_remesh},
+    {"deform", build_deform},
+    {"conic-booleans", [] {build_conic_booleans(6);}},
+
+    // Evaluate and store everything from scratch.
+
+    {"store-cold", [] {build_difference_chain(8);}, [] {
+        clear_store();
+        Flags::store_operations = 1;
+        Flags::load_operations = 1;
+    }},
+
+    // Load everything stored in a preceding evaluation.
+
+    {"store-warm", [] {build_difference_chain(8);}, [] {
+        Flags::store_operations = 1;
+        Flags::load_operations = 1;
+    }, [] {
+        clear_store();
+    }}};
+
+/////////////
+// Results //
+/////////////
+
+struct Samples {
+    std::string tag;
+    std::vector<double> times;
+};
+
+struct Result {
+    std::string name;
+    Samples total;
+    std::map<std::string, Samples> operations;
+};
+
+static double median(std::vector<double> v)
+{
+    if (v.empty()) {
+        return 0;
+    }
+
+    const std::size_t n = v.size() / 2;
+
+    std::nth_element(v.begin(), v.begin() + n, v.end());
+
+    if (v.size() % 2 == 0) {
+        return (*std::max_element(v.begin(), v.begin() + n) + v[n]) / 2;
+    }
+
+    return v[n];
+}
+
+static double mean(const std::vector<double> &v)
+{
+    double s = 0;
+
+    for (double x: v) {
+        s += x;
+    }
+
+    return v.empty() ? 0 : s / v.size();
+}
+
+static double variance(const std::vector<double> &v)
+{
+    const double mu = mean(v);
+    double s = 0;
+
+    for (double x: v) {
+        s += (x - mu) * (x - mu);
+    }
+
+    return v.size() < 2 ? 0 : s / (v.size() - 1);
+}
+
+static Result run_workload(const Workload &w, const int repetitions)
+{
+    Result r;
+
+    r.name = w.name;
+
+    for (int i = w.prepare ? -1 : 0; i < repetitions; i++) {
+        reset_options();
+
+        if (i < 0) {
+            w.prepare();
+        }
+
+        if (w.set_up) {
+            w.set_up();
+        }
+
+        begin_unit(w.name);
+        w.build();
+
+        auto t_0 = std::chrono::steady_clock::now();
+        evaluate_unit();
+        const double t = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - t_0).count();
+
+        if (i < 0) {
+            continue;
+        }
+
+        r.total.times.push_back(t);
+
+        // Collect the times of the operations that were evaluated,
+        // or loaded, from the cost database.
+
+        for (const auto &[k, op]: _get_operations()) {
+            const bool loaded = op->annotations.count("loaded") > 0;
+
+            if (!loaded && op->annotations.count("in") == 0) {
+                continue;
+            }
+
+            const Operation_costs c = find_operation_costs(op->digest());
+            Samples &s = r.operations[op->digest()];
+
+            if (s.tag.empty()) {
+                s.tag = op->describe();
+
+                if (s.tag.size() > 80) {
+                    s.tag.replace(77, std::string::npos, "...");
+                }
+            }
+
+            s.times.push_back(loaded ? c.load_time : c.evaluation_time);
+        }
+    }
+
+    return r;
+}
+
+//////////
+// JSON //
+//////////
+
+static std::string quote(const std::string &s)
+{
+    std::ostringstream t;
+
+    t << '"';
+
+    for (const char c: s) {
+        if (c == '"' || c == '\\') {
+            t << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            t << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << static_cast<int>(c) << std::dec << std::setfill(' ');
+        } else {
+            t << c;
+        }
+    }
+
+    t << '"';
+
+    return t.str();
+}
+
+static void write_samples(std::ostream &s, const Samples &x)
+{
+    s << "\"times\": [";
+
+    for (std::size_t i = 0; i < x.times.size(); i++) {
+        s << (i > 0 ? ", " : "") << x.times[i];
+    }
+
+    s << "], \"median\": " << median(x.times);
+}
+
+static void write_results(std::ostream &s, const std::vector<Result> &v,
+                          const int repetitions)
+{
+    s << std::setprecision(6)
+      << "{\n"
+      << "  \"threads\": " << (Options::threads < 0
+                               ? std::thread::hardware_concurrency()
+                               : Options::threads) << ",\n"
+      << "  \"repetitions\": " << repetitions << ",\n"
+      << "  \"workloads\": [";
+
+    for (std::size_t i = 0; i < v.size(); i++) {
+        const Result &r = v[i];
+
+        s << (i > 0 ? "," : "") << "\n    {\n"
+          << "      \"name\": " << quote(r.name) << ",\n      ";
+
+        write_samples(s, r.total);
+
+        s << ",\n      \"operations\": [";
+
+        bool first = true;
+
+        for (const auto &[k, x]: r.operations) {
+            s << (first ? "" : ",") << "\n        {\"digest\": "
+              << quote(k) << ", \"tag\": " << quote(x.tag) << ", ";
+
+            write_samples(s, x);
+
+            s << "}";
+            first = false;
+        }
+
+        s << "\n      ]\n    }";
+    }
+
+    s << "\n  ]\n}" << std::endl;
+}
+
+// A minimal parser for JSON values, sufficient for reading back
+// results.  Parsing errors are reported by throwing
+// std::runtime_error.
+
+struct Json_value {
+    double number = 0;
+    std::string string;
+    std::vector<Json_value> array;
+    std::vector<std::pair<std::string, Json_value>> object;
+
+    const Json_value *find(const std::string &k) const {
+        for (const auto &[l, x]: object) {
+            if (l == k) {
+                return &x;
+            }
+        }
+
+        return nullptr;
+    }
+};
+
+class Json_parser {
+    const std::string &s;
+    std::size_t i;
+
+    char peek() {
+        i = s.find_first_not_of(" \t\r\n", i);
+
+        if (i == std::string::npos) {
+            throw std::runtime_error("unexpected end of input");
+        }
+
+        return s[i];
+    }
+
+    void expect(const char c) {
+        if (peek() != c) {
+            throw std::runtime_error(
+                std::string("expected '") + c + "' at offset "
+                + std::to_string(i));
+        }
+
+        i++;
+    }
+
+    std::string parse_string() {
+        std::string t;
+
+        expect('"');
+
+        for (; i < s.size() && s[i] != '"'; i++) {
+            if (s[i] == '\\' && ++i < s.size()) {
+                if (s[i] == 'u' && i + 4 < s.size()) {
+                    t += static_cast<char>(
+                        std::stoi(s.substr(i + 1, 4), nullptr, 16));
+                    i += 4;
+                } else {
+                    t += (s[i] == 'n' ? '\n' : s[i] == 't' ? '\t' : s[i]);
+                }
+            } else {
+                t += s[i];
+            }
+        }
+
+        expect('"');
+
+        return t;
+    }
+
+    // Parse a number, or one of the literals, which are taken to be
+    // zero.
+
+    double parse_literal() {
+        const std::size_t j = s.find_first_of(",]} \t\r\n", i);
+        const std::string t = s.substr(i, j - i);
+
+        i = j;
+
+        if (t == "true" || t == "false" || t == "null") {
+            return 0;
+        }
+
+        std::size_t n;
+        const double x = std::stod(t, &n);
+
+        if (n != t.size()) {
+            throw std::runtime_error("invalid literal '" + t + "'");
+        }
+
+        return x;
+    }
+
+public:
+    Json_parser(const std::string &t): s(t), i(0) {}
+
+    Json_value parse() {
+        Json_value x;
+
+        switch (peek()) {
+        case '{':
+            i++;
+
+            if (peek() == '}') {
+                i++;
+                break;
+            }
+
+            for (;; i++) {
+                std::string k = parse_string();
+
+                expect(':');
+                x.object.emplace_back(std::move(k), parse());
+
+                if (peek() != ',') {
+                    break;
+                }
+            }
+
+            expect('}');
+            break;
+
+        case '[':
+            i++;
+
+            if (peek() == ']') {
+                i++;
+                break;
+            }
+
+            for (;; i++) {
+                x.array.push_back(parse());
+
+                if (peek() != ',') {
+                    break;
+                }
+            }
+
+            expect(']');
+            break;
+
+        case '"':
+            x.string = parse_string();
+            break;
+
+        default:
+            x.number = parse_literal();
+        }
+
+        return x;
+    }
+};
+
+static std::vector<Result> read_results(const std::string &filename)
+{
+    std::ifstream f(filename);
+    const std::string t((std::istreambuf_iterator<char>(f)),
+                        std::istreambuf_iterator<char>());
+
+    if (!f) {
+        throw std::runtime_error("could not read '" + filename + "'");
+    }
+
+    const Json_value x = Json_parser(t).parse();
+    const Json_value *v = x.find("workloads");
+
+    if (!v) {
+        throw std::runtime_error("no workloads in '" + filename + "'");
+    }
+
+    auto read_times = [](const Json_value &y, Samples &s) {
+        if (const Json_value *z = y.find("times")) {
+            for (const Json_value &w: z->array) {
+                s.times.push_back(w.number);
+            }
+        }
+    };
+
+    std::vector<Result> u;
+
+    for (const Json_value &y: v->array) {
+        Result r;
+
+        if (const Json_value *z = y.find("name")) {
+            r.name = z->string;
+        }
+
+        read_times(y, r.total);
+
+        if (const Json_value *z = y.find("operations")) {
+            for (const Json_value &w: z->array) {
+                const Json_value *k = w.find("digest");
+
+                if (k) {
+                    Samples &s = r.operations[k->string];
+
+                    if (const Json_value *l = w.find("tag")) {
+                        s.tag = l->string;
+                    }
+
+                    read_times(w, s);
+                }
+            }
+        }
+
+        u.push_back(std::move(r));
+    }
+
+    return u;
+}
+
+////////////////
+// Comparison //
+////////////////
+
+// Compare two sets of samples, returning whether the second is
+// slower than the first, by more than the given fraction of its
+// median, and significantly so, as judged by Welch's t-statistic.
+
+static bool regressed(const Samples &a, const Samples &b,
+                      const double threshold, const double significance,
+                      double &ratio, double &t)
+{
+    const double m_a = median(a.times), m_b = median(b.times);
+
+    if (a.times.empty() || b.times.empty() || m_a <= 0) {
+        ratio = t = 0;
+        return false;
+    }
+
+    const double d = mean(b.times) - mean(a.times);
+    const double sigma = std::sqrt(variance(a.times) / a.times.size()
+                                   + variance(b.times) / b.times.size());
+
+    ratio = m_b / m_a;
+    t = (sigma > 0 ? d / sigma : d > 0 ? INFINITY : 0);
+
+    return ratio > 1 + threshold && t >= significance;
+}
+
+static bool compare_results(const std::vector<Result> &baseline,
+                            const std::vector<Result> &v,
+                            const double threshold,
+                            const double significance)
+{
+    bool p = false;
+
+    std::cerr << std::setw(24) << std::left << "workload" << std::right
+              << std::setw(16) << "baseline (s)"
+              << std::setw(16) << "current (s)"
+              << std::setw(12) << "ratio"
+              << std::setw(12) << "t" << std::endl;
+
+    for (const Result &r: v) {
+        auto it = std::find_if(baseline.begin(), baseline.end(),
+                               [&r](const Result &x) {
+                                   return x.name == r.name;
+                               });
+
+        if (it == baseline.end()) {
+            continue;
+        }
+
+        double ratio, t;
+        const bool q = regressed(
+            it->total, r.total, threshold, significance, ratio, t);
+
+        std::cerr << std::setw(24) << std::left << r.name << std::right
+                  << std::setprecision(3)
+                  << std::setw(16) << median(it->total.times)
+                  << std::setw(16) << median(r.total.times)
+                  << std::setw(12) << ratio
+                  << std::setw(12) << t
+                  << (q ? "  REGRESSED" : "") << std::endl;
+
+        p = p || q;
+
+        // Point out the operations responsible.
+
+        for (const auto &[k, x]: r.operations) {
+            auto jt = it->operations.find(k);
+
+            if (jt != it->operations.end()
+                && regressed(jt->second, x, threshold, significance,
+                             ratio, t)) {
+                std::cerr << "    " << x.tag << ": "
+                          << median(jt->second.times) << "s -> "
+                          << median(x.times) << "s" << std::endl;
+            }
+        }
+    }
+
+    return p;
+}
+
+int main(int argc, char *argv[])
+{
+    enum {
+        THRESHOLD = 1000,
+        SIGNIFICANCE};
+
+    static struct option options[] = {
+        {"repetitions", required_argument, 0, 'r'},
+        {"threads", required_argument, 0, 't'},
+        {"output", required_argument, 0, 'o'},
+        {"baseline", required_argument, 0, 'b'},
+        {"threshold", required_argument, 0, THRESHOLD},
+        {"significance", required_argument, 0, SIGNIFICANCE},
+        {"list", no_argument, 0, 'l'},
+        {0, 0, 0, 0}};
+
+    int repetitions = 5, threads = Options::threads;
+    double threshold = 0.1, significance = 2;
+    std::string output, baseline;
+
+    for (int c; (c = getopt_long(
+                     argc, argv, "r:t:o:b:l", options, nullptr)) != -1;) {
+        switch (c) {
+        case 'r': repetitions = std::atoi(optarg); break;
+        case 't': threads = std::atoi(optarg); break;
+        case 'o': output = std::filesystem::absolute(optarg); break;
+        case 'b': baseline = std::filesystem::absolute(optarg); break;
+        case THRESHOLD: threshold = std::atof(optarg); break;
+        case SIGNIFICANCE: significance = std::atof(optarg); break;
+
+        case 'l':
+            for (const Workload &w: workloads) {
+                std::cout << w.name << std::endl;
+            }
+
+            return EXIT_SUCCESS;
+
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (repetitions <= 0
+        || threads < -1
+        || threshold < 0) {
+        std::cerr << "usage: " << argv[0] << " [OPTION...] [WORKLOAD...]"
+                  << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    Options::threads = threads;
+
+    std::vector<const Workload *> selected;
+
+    for (const Workload &w: workloads) {
+        if (optind == argc
+            || std::find_if(argv + optind, argv + argc,
+                            [&w](const char *s) {
+                                return w.name == std::string(s);
+                            }) != argv + argc) {
+            selected.push_back(&w);
+        }
+    }
+
+    CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+    CGAL::set_warning_behaviour(CGAL::THROW_EXCEPTION);
+
+    Flags::eliminate_dead_operations = 0;
+    Options::cost_database = nullptr;
+
+    // Work in a temporary directory, so that stored operations don't
+    // interfere with the workloads.
+
+    const std::filesystem::path cwd = std::filesystem::current_path();
+    std::string d = (std::filesystem::temp_directory_path()
+                     / "gamma-bench-XXXXXX");
+
+    if (!mkdtemp(d.data())) {
+        std::cerr << "Could not create a temporary directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::current_path(d);
+
+    std::vector<Result> v;
+
+    for (const Workload *w: selected) {
+        std::cerr << w->name << "..." << std::endl;
+        v.push_back(run_workload(*w, repetitions));
+    }
+
+    std::filesystem::current_path(cwd);
+    std::filesystem::remove_all(d);
+
+    if (output.empty()) {
+        write_results(std::cout, v, repetitions);
+    } else {
+        std::ofstream f(output);
+        write_results(f, v, repetitions);
+
+        if (!f) {
+            std::cerr << "Could not write results to '" << output << "'"
+                      << std::endl;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!baseline.empty()) {
+        try {
+            if (compare_results(read_results(baseline), v,
+                                threshold, significance)) {
+                return EXIT_FAILURE;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Could not compare against baseline: " << e.what()
+                      << std::endl;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
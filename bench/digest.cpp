@@ -0,0 +1,322 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Measure the cost of computing operation digests, comparing the
+// original, byte-oriented SHA-1 implementation over full operation
+// descriptions (i.e. the tags of old), with the current one, both
+// over full descriptions and over the structural descriptions that
+// tags are now computed from.  The operations are taken from the
+// given scripts or, failing that, from a synthetic model.
+//
+// Usage: bench_digest [SCRIPT...]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <CGAL/assertions.h>
+
+#include "options.h"
+#include "kernel.h"
+#include "transformations.h"
+#include "digest.h"
+#include "macros.h"
+
+#ifdef HAVE_LUA
+#include "lua_frontend.h"
+#endif
+
+#ifdef HAVE_SCHEME
+#include "scheme_frontend.h"
+#endif
+
+std::unordered_map<std::string, std::shared_ptr<Operation>> &_get_operations();
+
+// The original implementation, kept verbatim for comparison.
+
+namespace original {
+
+static std::uint32_t rotl32 (std::uint32_t x, unsigned int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static std::string sha1digest(const std::string &message)
+{
+    const std::uint8_t *s =
+        reinterpret_cast<const std::uint8_t *>(message.c_str());
+    const int n = message.size();
+
+    std::uint8_t buffer[64];
+
+    std::uint32_t h_0 = 0x67452301;
+    std::uint32_t h_1 = 0xefcdab89;
+    std::uint32_t h_2 = 0x98badcfe;
+    std::uint32_t h_3 = 0x10325476;
+    std::uint32_t h_4 = 0xc3d2e1f0;
+
+    for (int j = 0; j < ((n + 9 + 63) / 64) * 64; j += 64) {
+        const std::uint8_t *p;
+
+        if (n - j >= 64) {
+            p = s + j;
+        } else {
+            int i = 0;
+
+            p = buffer;
+
+            if (j <= n) {
+                memcpy(buffer, s + j, (i = n - j));
+                buffer[i++] = 0x80;
+            }
+
+            if (i <= 56) {
+
+                memset(buffer + i, 0, 56 - i);
+                for (auto [k, m] = std::pair<int, std::uint64_t>(63, n * 8);
+                     k >= 56;
+                     k--, m >>= 8) {
+                    buffer[k] = m & 0xff;
+                }
+            } else {
+                memset(buffer + i, 0, 64 - i);
+            }
+        }
+
+        std::uint32_t w[80];
+
+        for (int i = 0; i < 16 ; i++) {
+            const std::uint8_t *q = p + i * 4;
+            w[i] = q[3] | (q[2] << 8) | (q[1] << 16) | (q[0] << 24);
+        }
+
+        for (int i = 16; i < 80 ; i++) {
+            w[i] = rotl32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+        }
+
+        std::uint32_t a = h_0;
+        std::uint32_t b = h_1;
+        std::uint32_t c = h_2;
+        std::uint32_t d = h_3;
+        std::uint32_t e = h_4;
+
+        for (int i = 0; i < 80 ; i++) {
+            std::uint32_t f, k;
+
+            if (i < 20) {
+                f = (b & c) | ((~ b) & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            std::uint32_t g = rotl32(a, 5) + f + e + k + w[i];
+
+            e = d;
+            d = c;
+            c = rotl32(b, 30);
+            b = a;
+            a = g;
+        }
+
+        h_0 = h_0 + a;
+        h_1 = h_1 + b;
+        h_2 = h_2 + c;
+        h_3 = h_3 + d;
+        h_4 = h_4 + e;
+    }
+
+    std::ostringstream h;
+    h << std::hex << h_0 << h_1 << h_2 << h_3 << h_4;
+    return h.str();
+}
+
+}
+
+// A row of holes, drilled through a slab, each one positioned by a
+// chain of transformations, as typically generated by scripts.
+
+static void build_model(const int n)
+{
+    auto p = CUBOID(2 * n + 2, 4, 2);
+
+    for (int i = 0; i < n; i++) {
+        auto q = TRANSFORM(CYLINDER(FT::ET(1, 2), 4),
+                           basic_rotation(90, 0));
+
+        p = DIFFERENCE(p, TRANSFORM(q, TRANSLATION_3(2 * i - n + 1, 0, 0)));
+    }
+}
+
+static void collect_descriptions(
+    std::vector<std::string> &full, std::vector<std::string> &structural)
+{
+    for (const auto &[k, op]: _get_operations()) {
+        full.push_back(op->describe());
+        structural.push_back(op->describe_structure());
+    }
+}
+
+// Digest all messages repeatedly, for at least a second, returning
+// the mean time per pass.
+
+static double measure(const std::vector<std::string> &v,
+                      std::function<std::string(const std::string &)> f)
+{
+    std::size_t n = 0, m = 0;
+    auto t_0 = std::chrono::steady_clock::now();
+    double t;
+
+    do {
+        for (const std::string &x: v) {
+            m += f(x).size();
+        }
+
+        n += 1;
+        t = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - t_0).count();
+    } while (t < 1);
+
+    // Make sure the digests are not optimized away.
+
+    if (m == 0) {
+        std::abort();
+    }
+
+    return t / n;
+}
+
+static std::size_t total_size(const std::vector<std::string> &v)
+{
+    std::size_t n = 0;
+
+    for (const std::string &x: v) {
+        n += x.size();
+    }
+
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+    CGAL::set_warning_behaviour(CGAL::THROW_EXCEPTION);
+
+    Flags::store_operations = 0;
+    Flags::load_operations = 0;
+
+    std::vector<std::string> full, structural;
+
+    for (int i = 1; i < argc; i++) {
+        int (*run)(const char *input, char **first, char **last) = nullptr;
+
+#ifdef HAVE_LUA
+        if (std::filesystem::path(argv[i]).extension() == ".lua") {
+            run = run_lua;
+        }
+#endif
+
+#ifdef HAVE_SCHEME
+        if (std::filesystem::path(argv[i]).extension() == ".scm") {
+            run = run_scheme;
+        }
+#endif
+
+        if (!run) {
+            std::cerr << argv[0] << ": " << argv[i]
+                      << ": no language backend for input file" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        Options::include_directories.push_front(
+            std::filesystem::path(argv[i]).parent_path().native());
+
+        begin_unit(argv[i]);
+
+        if (run(argv[i], argv + argc, argv + argc) != 0) {
+            return EXIT_FAILURE;
+        }
+
+        collect_descriptions(full, structural);
+        discard_unit();
+
+        Options::include_directories.pop_front();
+    }
+
+    if (argc == 1) {
+        begin_unit("bench");
+        build_model(200);
+        collect_descriptions(full, structural);
+        discard_unit();
+    }
+
+    for (const std::string &x: full) {
+        if (original::sha1digest(x) != legacy_sha1digest(x)) {
+            std::cerr << argv[0] << ": digests differ for '" << x << "'"
+                      << std::endl;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << full.size() << " operations, using the "
+              << sha1_implementation() << " implementation" << std::endl
+              << std::endl
+              << std::setw(40) << std::left << "" << std::right
+              << std::setw(12) << "size (kB)"
+              << std::setw(12) << "time (ms)"
+              << std::setw(12) << "MB/s"
+              << std::setw(16) << "per tag (us)" << std::endl;
+
+    const std::pair<const char *, double> v[] = {
+        {"original, full descriptions",
+         measure(full, original::sha1digest)},
+        {"current, full descriptions",
+         measure(full, sha1digest)},
+        {"current, structural descriptions",
+         measure(structural, sha1digest)}};
+
+    for (int i = 0; i < 3; i++) {
+        const std::size_t n = total_size(i < 2 ? full : structural);
+        const double t = v[i].second;
+
+        std::cout << std::setw(40) << std::left << v[i].first << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << n / 1e3
+                  << std::setw(12) << t * 1e3
+                  << std::setw(12) << n / t / 1e6
+                  << std::setprecision(3)
+                  << std::setw(16) << t / full.size() * 1e6 << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Measure the cost of building and walking the evaluation graph, on
+// synthetic graphs of operations that do no work: a single long chain,
+// as formed by successive transformations, a layered graph, where
+// each operation depends on two operations of the previous layer, and
+// a chain built twice over, so that half the operations added are
+// duplicates.
+// Evaluation of such graphs, on a single thread, consists of
+// selection, prioritization and scheduling.
+//
+// Usage: bench_graph [OPERATIONS]
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "options.h"
+#include "basic_operations.h"
+#include "evaluation.h"
+#include "heap.h"
+
+class Nop_operation: public Nary_operation<Operation, Threadsafe_operation> {
+    int index;
+
+public:
+    Nop_operation(int i, std::vector<std::shared_ptr<Operation>> &&v):
+        Nary_operation(std::move(v)), index(i) {}
+
+    std::string describe() const override {
+        return compose_tag("nop", index);
+    }
+
+    void evaluate() override {}
+};
+
+static void build_chain(const int n)
+{
+    auto p = add_operation<Nop_operation>(
+        0, std::vector<std::shared_ptr<Operation>>());
+
+    for (int i = 1; i < n; i++) {
+        p = add_operation<Nop_operation>(
+            i, std::vector<std::shared_ptr<Operation>>({p}));
+    }
+}
+
+static void build_repeated_chain(const int n)
+{
+    build_chain(n / 2);
+    build_chain(n - n / 2);
+}
+
+static void build_layers(const int n)
+{
+    const int w = 100;
+    std::vector<std::shared_ptr<Operation>> u, v;
+
+    for (int i = 0; i < n; i++) {
+        const int j = i % w;
+
+        if (u.empty()) {
+            v.push_back(add_operation<Nop_operation>(
+                            i, std::vector<std::shared_ptr<Operation>>()));
+        } else {
+            v.push_back(add_operation<Nop_operation>(
+                            i, std::vector<std::shared_ptr<Operation>>(
+                                {u[j], u[(j * 7 + 1) % u.size()]})));
+        }
+
+        if (j == w - 1) {
+            u = std::move(v);
+            v.clear();
+        }
+    }
+}
+
+static double seconds(std::function<void()> f)
+{
+    auto t_0 = std::chrono::steady_clock::now();
+
+    f();
+
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - t_0).count();
+}
+
+int main(int argc, char *argv[])
+{
+    const int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    if (n <= 0) {
+        std::cerr << "usage: " << argv[0] << " [OPERATIONS]" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    Flags::eliminate_dead_operations = 0;
+    Flags::store_operations = 0;
+    Flags::load_operations = 0;
+    Options::cost_database = nullptr;
+    Options::threads = 0;
+
+    std::cout << n << " operations of " << sizeof(Nop_operation)
+              << " bytes" << std::endl << std::endl
+              << std::setw(10) << "graph"
+              << std::setw(16) << "build (s)"
+              << std::setw(16) << "heap (B/op)"
+              << std::setw(16) << "evaluate (s)"
+              << std::setw(24) << "per operation (us)" << std::endl;
+
+    const std::pair<const char *, void (*)(int)> v[] = {
+        {"chain", build_chain}, {"layers", build_layers},
+        {"repeated", build_repeated_chain}};
+
+    for (const auto &[s, f]: v) {
+        begin_unit("bench");
+
+        const Heap_measurement m = begin_heap_measurement();
+        const double t_b = seconds([f = f, n]() { f(n); });
+        const std::size_t h = end_heap_measurement(m);
+        const double t_e = seconds(evaluate_unit);
+
+        std::cout << std::setw(10) << s
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(16) << t_b
+                  << std::setprecision(0)
+                  << std::setw(16) << static_cast<double>(h) / n
+                  << std::setprecision(3)
+                  << std::setw(16) << t_e
+                  << std::setw(24) << (t_b + t_e) / n * 1e6 << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Measure the overhead of scheduling, by evaluating a layered graph
+// of operations that do no work, for increasing numbers of threads.
+//
+// Usage: bench_scheduling [OPERATIONS [WIDTH [THREADS]]]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "options.h"
+#include "basic_operations.h"
+#include "evaluation.h"
+
+class Nop_operation: public Nary_operation<Operation, Threadsafe_operation> {
+    int index;
+
+public:
+    Nop_operation(int i, std::vector<std::shared_ptr<Operation>> &&v):
+        Nary_operation(std::move(v)), index(i) {}
+
+    // Don't include the operands' tags, as the size of tags would
+    // then grow exponentially with the depth of the graph.
+
+    std::string describe() const override {
+        return compose_tag("nop", index);
+    }
+
+    void evaluate() override {}
+};
+
+// Create a graph of n operations, in layers of w operations each.
+// Each operation depends on two operations of the previous layer.
+
+static void build_graph(int n, int w)
+{
+    std::vector<std::shared_ptr<Operation>> u, v;
+
+    for (int i = 0; i < n; i++) {
+        const int j = i % w;
+
+        if (u.empty()) {
+            v.push_back(add_operation<Nop_operation>(
+                            i, std::vector<std::shared_ptr<Operation>>()));
+        } else {
+            v.push_back(add_operation<Nop_operation>(
+                            i, std::vector<std::shared_ptr<Operation>>(
+                                {u[j], u[(j * 7 + 1) % u.size()]})));
+        }
+
+        if (j == w - 1) {
+            u = std::move(v);
+            v.clear();
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const int w = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int m = (argc > 3 ? std::atoi(argv[3])
+                   : static_cast<int>(std::thread::hardware_concurrency()));
+
+    if (n <= 0 || w <= 0 || m < 0) {
+        std::cerr << "usage: " << argv[0]
+                  << " [OPERATIONS [WIDTH [THREADS]]]"
+                  << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    Flags::eliminate_dead_operations = 0;
+    Flags::store_operations = 0;
+    Flags::load_operations = 0;
+    Options::cost_database = nullptr;
+
+    std::cout << std::setw(8) << "threads"
+              << std::setw(16) << "total (s)"
+              << std::setw(24) << "per operation (us)" << std::endl;
+
+    for (int k = 0; k <= m; k = (k == 0 ? 1 : 2 * k)) {
+        begin_unit("bench");
+        build_graph(n, w);
+
+        Options::threads = k;
+
+        auto t_0 = std::chrono::steady_clock::now();
+        evaluate_unit();
+        const double t = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - t_0).count();
+
+        std::cout << std::setw(8) << k
+                  << std::setw(16) << std::setprecision(3) << t
+                  << std::setw(24) << std::setprecision(3) << t / n * 1e6
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
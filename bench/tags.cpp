@@ -0,0 +1,157 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Measure the cost of graph construction, i.e. of adding operations
+// to a unit, which entails composing their tags, on a synthetic model
+// of polygons with coordinates given as literals, as is typical of
+// scripts.  The composition of tags is also measured separately and
+// compared with composition through a string stream, with exact
+// evaluation of all coordinates, as tags were originally composed.
+//
+// Usage: bench_tags [OPERATIONS]
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <CGAL/assertions.h>
+
+#include "options.h"
+#include "kernel.h"
+#include "transformations.h"
+#include "macros.h"
+
+// Random-ish polygon vertices, with coordinates such as those written
+// in scripts.
+
+static std::vector<Point_2> make_points(const int i, const int n)
+{
+    std::vector<Point_2> v;
+
+    v.reserve(n);
+
+    for (int j = 0; j < n; j++) {
+        v.emplace_back(0.125 * ((i * 31 + j * 17) % 97),
+                       0.1 * ((i * 13 + j * 29) % 89));
+    }
+
+    return v;
+}
+
+// A union of translated polygons, built one at a time.
+
+static void build_model(const int n)
+{
+    auto p = POLYGON(make_points(0, 8));
+
+    for (int i = 1; i < n / 2; i++) {
+        p = JOIN(p, TRANSFORM(POLYGON(make_points(i, 8)),
+                              TRANSLATION_2(0.5 * i, 0.25 * i)));
+    }
+}
+
+static std::string compose_with_stream(const std::vector<Point_2> &v)
+{
+    std::ostringstream s;
+
+    s << "polygon(";
+
+    for (const Point_2 &P: v) {
+        s << "point(" << P.x().exact() << "," << P.y().exact() << "),";
+    }
+
+    s.seekp(-1, std::ios_base::end);
+    s << ")";
+
+    return s.str();
+}
+
+static double seconds(std::function<void()> f)
+{
+    auto t_0 = std::chrono::steady_clock::now();
+
+    f();
+
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - t_0).count();
+}
+
+int main(int argc, char *argv[])
+{
+    const int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    if (n <= 0) {
+        std::cerr << "usage: " << argv[0] << " [OPERATIONS]" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+    CGAL::set_warning_behaviour(CGAL::THROW_EXCEPTION);
+
+    // Graph construction
+
+    begin_unit("bench");
+    const double t = seconds([n]() { build_model(n); });
+    discard_unit();
+
+    std::cout << "graph construction: " << n << " operations in "
+              << std::fixed << std::setprecision(3) << t << " s ("
+              << std::setprecision(2) << t / n * 1e6 << " us per operation)"
+              << std::endl;
+
+    // Tag composition, over separate copies of the same points, as
+    // streaming forces their exact evaluation.
+
+    std::vector<std::vector<Point_2>> u, v;
+
+    for (int i = 0; i < n / 16; i++) {
+        u.push_back(make_points(i, 16));
+        v.push_back(make_points(i, 16));
+    }
+
+    std::size_t a = 0, b = 0;
+    const double t_s = seconds([&u, &a]() {
+        for (const auto &x: u) {
+            a += compose_with_stream(x).size();
+        }
+    });
+
+    const double t_c = seconds([&v, &b]() {
+        for (const auto &x: v) {
+            b += compose_tag("polygon", x).size();
+        }
+    });
+
+    if (a != b) {
+        std::cerr << argv[0] << ": tags differ" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "tag composition: " << v.size() << " tags of "
+              << b / v.size() << " bytes" << std::endl
+              << std::setprecision(3)
+              << "  through a stream: " << t_s << " s" << std::endl
+              << "  in a buffer: " << t_c << " s" << std::endl;
+
+    return EXIT_SUCCESS;
+}
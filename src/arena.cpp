@@ -0,0 +1,40 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "arena.h"
+
+// Chunks are large enough for a few hundred operations.  Allocations
+// that don't fit are given a chunk of their own.
+
+static const std::size_t chunk_size = 65536;
+
+void *Arena::allocate_chunk(const std::size_t n, const std::size_t alignment)
+{
+    const std::size_t m = std::max(chunk_size, n + alignment - 1);
+
+    chunks.emplace_back(new char[m]);
+    size += m;
+
+    char *p = chunks.back().get();
+
+    top = p + (-reinterpret_cast<std::uintptr_t>(p) & (alignment - 1));
+    end = p + m;
+
+    return allocate(n, alignment);
+}
@@ -0,0 +1,130 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// An arena, from which memory is allocated by bumping a pointer
+// within large chunks, and released as a whole, once the arena is
+// destroyed.  Individual allocations can't be freed, save for the
+// most recent ones, by rewinding the arena to a mark taken before
+// they were made.  The arena isn't thread-safe; operations are
+// allocated from the arena of their unit, during construction of the
+// graph.
+
+class Arena {
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char *top, *end;
+    std::size_t allocations, size;
+
+    void *allocate_chunk(std::size_t n, std::size_t alignment);
+
+public:
+    struct Mark {
+        char *top;
+        std::size_t allocations;
+    };
+
+    Arena(): top(nullptr), end(nullptr), allocations(0), size(0) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(const std::size_t n, const std::size_t alignment) {
+        const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(top);
+        char *q = top + (-p & (alignment - 1));
+
+        if (!top || n > static_cast<std::size_t>(end - q)) {
+            return allocate_chunk(n, alignment);
+        }
+
+        top = q + n;
+        allocations++;
+
+        return q;
+    }
+
+    Mark mark() const {
+        return {top, allocations};
+    }
+
+    // Release the memory allocated since the mark was taken, provided
+    // that it was a single allocation, made within the same chunk.
+    // Returns whether the memory was released.
+
+    bool rewind(const Mark &m) {
+        if (allocations != m.allocations + 1
+            || chunks.empty()
+            || m.top < chunks.back().get() || m.top > end) {
+            return false;
+        }
+
+        top = m.top;
+        allocations = m.allocations;
+
+        return true;
+    }
+
+    // The total size of the arena's chunks, in bytes.
+
+    std::size_t capacity() const {
+        return size;
+    }
+};
+
+// An allocator drawing from an arena, e.g. for use with
+// std::allocate_shared.  Deallocation is a no-op.  The allocator
+// shares ownership of the arena, so that the arena outlives any
+// objects allocated from it.
+
+template<typename T>
+class Arena_allocator {
+    template<typename U> friend class Arena_allocator;
+
+    std::shared_ptr<Arena> arena;
+
+public:
+    typedef T value_type;
+
+    Arena_allocator(const std::shared_ptr<Arena> &a): arena(a) {}
+
+    template<typename U>
+    Arena_allocator(const Arena_allocator<U> &other): arena(other.arena) {}
+
+    T *allocate(const std::size_t n) {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, std::size_t) {}
+
+    template<typename U>
+    bool operator==(const Arena_allocator<U> &other) const {
+        return arena == other.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const Arena_allocator<U> &other) const {
+        return arena != other.arena;
+    }
+};
+
+#endif
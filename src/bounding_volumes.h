@@ -55,9 +55,10 @@ template<typename T>
 struct compose_tag_helper<std::shared_ptr<T>,
                           std::enable_if_t<
                               std::is_base_of_v<Bounding_volume, T>>> {
-    static void compose(std::ostringstream &s, const std::shared_ptr<T> &x) {
+    static void compose(std::string &s, const std::shared_ptr<T> &x) {
         if (x) {
-            s << x->describe() << ",";
+            s += x->describe();
+            s += ',';
         }
     }
 };
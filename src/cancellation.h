@@ -0,0 +1,79 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <boost/property_map/property_map.hpp>
+#include <CGAL/Polygon_mesh_processing/corefinement.h>
+
+#include "operation.h"
+
+// A corefinement visitor, which allows corefinement to be abandoned,
+// once evaluation has been cancelled.  The callbacks below are
+// invoked for each intersection point and each intersected or
+// copied face, i.e. frequently enough for our purposes.
+
+template<typename T>
+struct Cancelling_corefinement_visitor:
+    public CGAL::Polygon_mesh_processing::Corefinement::Default_visitor<T> {
+
+    typedef typename boost::graph_traits<T>::face_descriptor face_descriptor;
+    typedef typename boost::graph_traits<T>::vertex_descriptor vertex_descriptor;
+
+    void new_vertex_added(std::size_t, vertex_descriptor, const T &) {
+        Operation::check_cancellation();
+    }
+
+    void before_subface_creations(face_descriptor, const T &) {
+        Operation::check_cancellation();
+    }
+
+    void before_face_copy(face_descriptor, const T &, const T &) {
+        Operation::check_cancellation();
+    }
+};
+
+// A property map wrapper, checking for cancellation whenever it's
+// read.  Algorithms without visitors, such as isotropic remeshing,
+// can be made cancellable by wrapping a map they consult throughout,
+// e.g. the map of constrained edges.
+
+template<typename M>
+struct Cancelling_property_map {
+    typedef typename boost::property_traits<M>::key_type key_type;
+    typedef typename boost::property_traits<M>::value_type value_type;
+    typedef typename boost::property_traits<M>::reference reference;
+    typedef typename boost::property_traits<M>::category category;
+
+    mutable M map;
+
+    Cancelling_property_map() = default;
+    Cancelling_property_map(const M &m): map(m) {}
+
+    friend reference get(const Cancelling_property_map &m, const key_type &k) {
+        Operation::check_cancellation();
+        return get(m.map, k);
+    }
+
+    friend void put(const Cancelling_property_map &m, const key_type &k,
+                    const value_type &v) {
+        put(m.map, k, v);
+    }
+};
+
+#endif
@@ -15,69 +15,180 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+
 #include "compose_tag.h"
 #include "kernel.h"
 
-#define SIMPLE_STREAM_INSERTION {               \
-    s << x << ",";                              \
+std::string &tag_buffer()
+{
+    thread_local std::string s;
+
+    return s;
+}
+
+// Integers are formatted directly into the buffer, instead of going
+// through the locale-aware machinery of streams.
+
+template<typename T>
+static void append_integer(std::string &s, const T x)
+{
+    char t[24];
+
+    s.append(t, std::to_chars(t, t + sizeof(t), x).ptr);
+}
+
+#ifdef CGAL_USE_GMPXX
+static void append_integer(std::string &s, mpz_srcptr z)
+{
+    const std::size_t n = s.size();
+
+    s.resize(n + mpz_sizeinbase(z, 10) + 2);
+    mpz_get_str(&s[n], 10, z);
+    s.resize(n + std::strlen(&s[n]));
+}
+#endif
+
+// Exact numbers are formatted directly as well, when they're GMP
+// rationals, and streamed otherwise.
+
+template<typename T>
+static void append_rational(std::string &s, const T &q)
+{
+#ifdef CGAL_USE_GMPXX
+    if constexpr (std::is_same_v<T, mpq_class>) {
+        append_integer(s, q.get_num_mpz_t());
+
+        if (mpz_cmp_ui(q.get_den_mpz_t(), 1) != 0) {
+            s += '/';
+            append_integer(s, q.get_den_mpz_t());
+        }
+
+        return;
+    }
+#endif
+
+    std::ostringstream t;
+
+    t << q;
+    s += t.str();
+}
+
+// Append the exact values of the coordinates of x, as enumerated by
+// f, each followed by a comma.  If the exact form of x hasn't been
+// computed yet, but its approximate coordinates are all point
+// intervals, then these are exact, so that exact evaluation can be
+// avoided.
+
+template<typename T, typename F>
+static void append_exact(std::string &s, const T &x, F f)
+{
+    if (x.ptr()->is_lazy()) {
+        bool p = true;
+
+        f(x.approx(), [&p](const auto &i) {
+            p = p && i.inf() == i.sup();
+        });
+
+        if (p) {
+            f(x.approx(), [&s](const auto &i) {
+                append_rational(s, FT::ET(i.inf()));
+                s += ',';
+            });
+
+            return;
+        }
+    }
+
+    f(x.exact(), [&s](const auto &q) {
+        append_rational(s, q);
+        s += ',';
+    });
 }
 
 template<>
-void compose_tag_helper<int>::compose(std::ostringstream &s, const int &x)
-SIMPLE_STREAM_INSERTION
+void compose_tag_helper<int>::compose(std::string &s, const int &x)
+{
+    append_integer(s, x);
+    s += ',';
+}
 
 template<>
 void compose_tag_helper<unsigned int>::compose(
-    std::ostringstream &s, const unsigned int &x)
-SIMPLE_STREAM_INSERTION
+    std::string &s, const unsigned int &x)
+{
+    append_integer(s, x);
+    s += ',';
+}
 
 template<>
 void compose_tag_helper<const char *>::compose(
-    std::ostringstream &s, const char * const &t)
+    std::string &s, const char * const &t)
 {
-    s << "\"" << t << "\",";
+    s += '"';
+    s += t;
+    s += "\",";
 }
 
 template<>
-void compose_tag_helper<FT>::compose(std::ostringstream &s, const FT &a)
+void compose_tag_helper<FT>::compose(std::string &s, const FT &a)
 {
-    s << a.exact() << ",";
+    append_exact(s, a, [](const auto &x, auto g) {
+        g(x);
+    });
 }
 
 template<>
-void compose_tag_helper<Point_2>::compose(
-    std::ostringstream &s, const Point_2 &P)
+void compose_tag_helper<Point_2>::compose(std::string &s, const Point_2 &P)
 {
-    s << "point(" << P.x().exact() << ","  << P.y().exact() << "),";
+    s += "point(";
+    append_exact(s, P, [](const auto &Q, auto g) {
+        g(Q.x());
+        g(Q.y());
+    });
+    s.back() = ')';
+    s += ',';
 }
 
 template<>
-void compose_tag_helper<Point_3>::compose(
-    std::ostringstream &s, const Point_3 &P)
+void compose_tag_helper<Point_3>::compose(std::string &s, const Point_3 &P)
 {
-    s << "point("
-      << P.x().exact() << ","
-      << P.y().exact() << ","
-      << P.z().exact() << "),";
+    s += "point(";
+    append_exact(s, P, [](const auto &Q, auto g) {
+        g(Q.x());
+        g(Q.y());
+        g(Q.z());
+    });
+    s.back() = ')';
+    s += ',';
 }
 
 template<>
-void compose_tag_helper<Vector_3>::compose(
-    std::ostringstream &s, const Vector_3 &v)
+void compose_tag_helper<Vector_3>::compose(std::string &s, const Vector_3 &v)
 {
-    s << "vector("
-      << v.x().exact() << ","
-      << v.y().exact() << ","
-      << v.z().exact() << "),";
+    s += "vector(";
+    append_exact(s, v, [](const auto &u, auto g) {
+        g(u.x());
+        g(u.y());
+        g(u.z());
+    });
+    s.back() = ')';
+    s += ',';
 }
 
 template<>
-void compose_tag_helper<Plane_3>::compose(
-    std::ostringstream &s, const Plane_3 &Pi)
+void compose_tag_helper<Plane_3>::compose(std::string &s, const Plane_3 &Pi)
 {
-    s << "plane("
-      << Pi.a().exact() << ","
-      << Pi.b().exact() << ","
-      << Pi.c().exact() << ","
-      << Pi.d().exact() << "),";
+    s += "plane(";
+    append_exact(s, Pi, [](const auto &Rho, auto g) {
+        g(Rho.a());
+        g(Rho.b());
+        g(Rho.c());
+        g(Rho.d());
+    });
+    s.back() = ')';
+    s += ',';
 }
@@ -18,22 +18,30 @@
 #ifndef COMPOSE_TAG_H
 #define COMPOSE_TAG_H
 
-#include <sstream>
-#include <ostream>
-#include <tuple>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// Tags are composed into a thread-local buffer, which is reused, so
+// that, once it has grown large enough, composition allocates nothing
+// beyond the resulting string.  Compositions can nest (e.g. when the
+// descriptions of operands are spelled out), each appending to the
+// buffer and truncating it back to where it started, once done.
+
+std::string &tag_buffer();
 
 // Simple values
 
 template<typename T, typename = void>
 struct compose_tag_helper {
-    static void compose(std::ostringstream &s, const T &x);
+    static void compose(std::string &s, const T &x);
 };
 
 // Iterables
 
 template<typename T, typename U>
 struct compose_tag_helper<std::pair<T, U>> {
-    static void compose(std::ostringstream &s, const std::pair<T, U> &p) {
+    static void compose(std::string &s, const std::pair<T, U> &p) {
         compose_tag_helper<T>::compose(s, p.first);
         compose_tag_helper<U>::compose(s, p.second);
     }
@@ -41,8 +49,8 @@ struct compose_tag_helper<std::pair<T, U>> {
 
 template<typename T>
 struct compose_tag_helper<T, std::enable_if_t<std::is_array_v<T>>> {
-    static void compose(std::ostringstream &s, const T &v) {
-        for (auto x: v) {
+    static void compose(std::string &s, const T &v) {
+        for (const auto &x: v) {
             compose_tag_helper<std::decay_t<decltype(x)>>::compose(s, x);
         }
     }
@@ -51,8 +59,8 @@ struct compose_tag_helper<T, std::enable_if_t<std::is_array_v<T>>> {
 template<typename T>
 struct compose_tag_helper<T, std::void_t<decltype(std::declval<T>().begin()),
                                          decltype(std::declval<T>().end())>> {
-    static void compose(std::ostringstream &s, const T &v) {
-        for (auto x: v) {
+    static void compose(std::string &s, const T &v) {
+        for (const auto &x: v) {
             compose_tag_helper<std::decay_t<decltype(x)>>::compose(s, x);
         }
     }
@@ -61,27 +69,29 @@ struct compose_tag_helper<T, std::void_t<decltype(std::declval<T>().begin()),
 template<typename... Args>
 std::string compose_tag(const char *name, Args &&... args)
 {
-    std::ostringstream s;
+    std::string &s = tag_buffer();
+    const std::size_t n = s.size();
 
-    s << name << "(";
-    if constexpr (sizeof...(Args) > 0) {
-        const auto p = s.tellp();
-        auto t = std::make_tuple(args...);
+    s += name;
+    s += '(';
 
-        (compose_tag_helper<std::remove_cv_t<
-                                std::remove_reference_t<Args>>>::compose(
-                                    s, args), ...);
+    (compose_tag_helper<std::remove_cv_t<
+                            std::remove_reference_t<Args>>>::compose(
+                                s, args), ...);
 
-        if (s.tellp() > p) {
-            s.seekp(-1, std::ios_base::end);
-        }
+    // Each value is followed by a comma, the last of which is
+    // replaced by the closing parenthesis.
 
-        s << ")";
+    if (s.back() == ',') {
+        s.back() = ')';
     } else {
-        s << ")";
+        s += ')';
     }
 
-    return s.str();
+    std::string t(s, n);
+    s.resize(n);
+
+    return t;
 }
 
 #endif
@@ -61,10 +61,13 @@ public:
     void evaluate() override;
 };
 
+// The result is a plain polygon set, but the conversion must still
+// take place on the main thread, as it accesses a conic polygon set.
+
 template<>
 class Polygon_convert_operation<Polygon_set, Conic_polygon_set>:
     public Unary_operation<Polygon_operation<Conic_polygon_set>,
-                           Polygon_operation<Polygon_set>> {
+                           Unsafe_polygon_operation<Polygon_set>> {
 
     FT tolerance;
 
@@ -72,7 +75,7 @@ public:
     Polygon_convert_operation<Polygon_set, Conic_polygon_set>(
         const std::shared_ptr<Polygon_operation<Conic_polygon_set>> &x):
         Unary_operation<Polygon_operation<Conic_polygon_set>,
-                        Polygon_operation<Polygon_set>>(x), tolerance(Tolerances::curve) {}
+                        Unsafe_polygon_operation<Polygon_set>>(x), tolerance(Tolerances::curve) {}
 
     void evaluate() override;
 
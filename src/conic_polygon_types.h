@@ -24,6 +24,7 @@
 #include <CGAL/General_polygon_set_2.h>
 
 #include "core_kernels.h"
+#include "polygon_types.h"
 
 typedef CGAL::Gps_traits_2<
     CGAL::Arr_conic_traits_2<
@@ -33,4 +34,17 @@ typedef Conic_traits::General_polygon_2 Conic_polygon;
 typedef Conic_traits::General_polygon_with_holes_2 Conic_polygon_with_holes;
 typedef CGAL::General_polygon_set_2<Conic_traits> Conic_polygon_set;
 
+// Conic polygon sets are built out of CORE numbers, which are
+// reference-counted non-atomically and allocated out of per-thread
+// memory pools, so that they must be confined to the main thread.
+
+template<>
+struct is_threadsafe_polygon_set<Conic_polygon_set>: std::false_type {};
+
+// Storing point coordinates of conics exactly is not very
+// straightforward, so they can't be stored.
+
+template<>
+struct is_storable_polygon_set<Conic_polygon_set>: std::false_type {};
+
 #endif
@@ -0,0 +1,254 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include "options.h"
+#include "cost_database.h"
+
+// Along with its costs, each entry records when it was last used, so
+// that the database can be pruned of the entries used least
+// recently.
+
+struct Entry {
+    Operation_costs costs;
+    long long used = 0;
+};
+
+static std::unordered_map<std::string, Entry> database;
+static std::mutex database_mutex;
+static bool database_loaded, database_dirty;
+
+#ifndef _WIN32
+// Make sure the database isn't left locked in child processes,
+// should they be forked while another thread holds the lock.
+
+static const int database_atfork = pthread_atfork(
+    [] { database_mutex.lock(); },
+    [] { database_mutex.unlock(); },
+    [] { database_mutex.unlock(); });
+#endif
+
+// The database is stored as text, one operation per line, in the
+// form:
+//
+// DIGEST EVALUATION-TIME LOAD-TIME SIZE MEMORY USED [KIND]
+//
+// where USED is the time of last use, in seconds since the epoch.
+// Malformed lines are skipped.
+
+void load_cost_database()
+{
+    std::lock_guard<std::mutex> lock(database_mutex);
+
+    if (database_loaded || !Options::cost_database) {
+        return;
+    }
+
+    database_loaded = true;
+
+    std::ifstream f(store_file_path(Options::cost_database));
+    std::string l;
+
+    while (std::getline(f, l)) {
+        std::istringstream s(l);
+        std::string k;
+        Entry e;
+        Operation_costs &c = e.costs;
+
+        // Costs recorded during this run take precedence.
+
+        if (s >> k
+            >> c.evaluation_time >> c.load_time >> c.size >> c.memory
+            >> e.used) {
+            s >> c.kind;
+            database.insert({k, e});
+        }
+    }
+}
+
+void save_cost_database()
+{
+    std::lock_guard<std::mutex> lock(database_mutex);
+
+    // The database is kept along with the stored operations, so
+    // don't write it unless storing.
+
+    if (!database_dirty || !Options::cost_database
+        || !Flags::store_operations) {
+        return;
+    }
+
+    // Prune the least recently used entries, if there are too many.
+
+    if (const int n = Options::cost_database_limit;
+        n >= 0 && database.size() > static_cast<std::size_t>(n)) {
+        std::vector<long long> v;
+
+        v.reserve(database.size());
+
+        for (const auto &[k, e]: database) {
+            v.push_back(e.used);
+        }
+
+        // Keep the n most recent entries, breaking ties arbitrarily.
+
+        auto it = v.begin() + (v.size() - n);
+        std::nth_element(v.begin(), it, v.end());
+
+        const long long t = n > 0 ? *it : 0;
+        std::size_t m = std::count(it, v.end(), t);
+
+        for (auto jt = database.begin(); jt != database.end();) {
+            const long long u = jt->second.used;
+
+            if (n == 0 || u < t || (u == t && m == 0)) {
+                jt = database.erase(jt);
+            } else {
+                m -= (u == t);
+                ++jt;
+            }
+        }
+    }
+
+    // Write to a temporary file first and move it into place, so
+    // as not to leave a partially written database behind.  The
+    // temporary file is uniquely named, as several processes may be
+    // sharing the database.
+
+    const std::string s = store_file_path(Options::cost_database);
+    std::string t = s + ".XXXXXX";
+
+    if (Options::store_directory) {
+        std::error_code e;
+        std::filesystem::create_directories(Options::store_directory, e);
+    }
+
+#ifndef _WIN32
+    const int fd = mkstemp(t.data());
+    const bool p = fd >= 0;
+
+    if (p) {
+        fchmod(fd, 0644);
+        close(fd);
+    }
+#else
+    const bool p = _mktemp_s(t.data(), t.size() + 1) == 0;
+#endif
+
+    std::ofstream f;
+
+    if (p) {
+        f.open(t);
+
+        for (const auto &[k, e]: database) {
+            const Operation_costs &c = e.costs;
+
+            f << k << ' '
+              << c.evaluation_time << ' ' << c.load_time << ' '
+              << c.size << ' ' << c.memory << ' ' << e.used;
+
+            if (!c.kind.empty()) {
+                f << ' ' << c.kind;
+            }
+
+            f << '\n';
+        }
+
+        f.close();
+    }
+
+    if (!p || !f || std::rename(t.c_str(), s.c_str()) != 0) {
+        std::cerr << "Could not write cost database to '" << s << "'"
+                  << std::endl;
+
+        if (p) {
+            std::remove(t.c_str());
+        }
+
+        return;
+    }
+
+    database_dirty = false;
+}
+
+Operation_costs find_operation_costs(const std::string &k)
+{
+    std::lock_guard<std::mutex> lock(database_mutex);
+
+    if (auto it = database.find(k); it != database.end()) {
+        it->second.used = std::time(nullptr);
+        database_dirty = true;
+
+        return it->second.costs;
+    }
+
+    return Operation_costs();
+}
+
+void record_operation_costs(const std::string &k, const Operation_costs &c)
+{
+    std::lock_guard<std::mutex> lock(database_mutex);
+    Entry &e = database[k];
+    Operation_costs &d = e.costs;
+
+    if (c.evaluation_time >= 0) {
+        d.evaluation_time = c.evaluation_time;
+        d.size = c.size;
+        d.memory = c.memory;
+    }
+
+    if (c.load_time >= 0) {
+        d.load_time = c.load_time;
+    }
+
+    if (!c.kind.empty()) {
+        d.kind = c.kind;
+    }
+
+    e.used = std::time(nullptr);
+    database_dirty = true;
+}
+
+void for_each_operation_costs(
+    const std::function<void(const std::string &,
+                             const Operation_costs &)> &f)
+{
+    std::lock_guard<std::mutex> lock(database_mutex);
+
+    for (const auto &[k, e]: database) {
+        f(k, e.costs);
+    }
+}
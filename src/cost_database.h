@@ -0,0 +1,60 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef COST_DATABASE_H
+#define COST_DATABASE_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// The costs incurred by an operation, as recorded on previous
+// evaluations.  Times are in seconds and are negative if unknown.
+// The size is an estimate of the memory occupied by the operation's
+// result, including the limbs of its exact coordinates, while memory
+// is the peak growth of the heap memory allocated by the evaluating
+// thread.  Both are in bytes.  The kind of the operation (see
+// Operation::kind()) is recorded along with them, so that costs can
+// be modelled per kind of operation.
+
+struct Operation_costs {
+    float evaluation_time = -1;
+    float load_time = -1;
+    std::size_t size = 0;
+    std::size_t memory = 0;
+    std::string kind;
+};
+
+// The cost database is keyed by operation digest.  It is kept in
+// memory for the duration of the process and, if
+// Options::cost_database is set, it is loaded from and saved to that
+// file, in the store directory, so that it persists across runs.  It
+// is only saved when storing operations and is then pruned to the
+// Options::cost_database_limit most recently used entries.  Recorded
+// costs are merged into existing entries: negative times are ignored,
+// while the size and memory are only updated along with the
+// evaluation time.
+
+void load_cost_database();
+void save_cost_database();
+Operation_costs find_operation_costs(const std::string &k);
+void record_operation_costs(const std::string &k, const Operation_costs &c);
+void for_each_operation_costs(
+    const std::function<void(const std::string &,
+                             const Operation_costs &)> &f);
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <limits>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "counters.h"
+
+// Denotes an event that couldn't be counted.
+
+static const std::uint64_t unavailable =
+    std::numeric_limits<std::uint64_t>::max();
+
+#ifdef __linux__
+
+static const struct {
+    const char *name;
+    std::uint32_t type;
+    std::uint64_t config;
+} events[event_counters_n] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}};
+
+// The counters of a thread are opened independently, rather than as
+// a group, so that unavailable events don't prevent counting the
+// rest.  They're reopened in forked child processes, as inherited
+// counters would count the parent's thread.
+
+struct Thread_counters {
+    pid_t pid = 0;
+    int fds[event_counters_n] = {-1, -1, -1, -1, -1};
+
+    ~Thread_counters() {
+        for (int fd: fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void open() {
+        for (int i = 0; i < event_counters_n; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+
+            struct perf_event_attr a;
+
+            std::memset(&a, 0, sizeof(a));
+            a.size = sizeof(a);
+            a.type = events[i].type;
+            a.config = events[i].config;
+            a.exclude_kernel = 1;
+            a.exclude_hv = 1;
+            a.read_format = (PERF_FORMAT_TOTAL_TIME_ENABLED
+                             | PERF_FORMAT_TOTAL_TIME_RUNNING);
+
+            fds[i] = syscall(SYS_perf_event_open, &a, 0, -1, -1,
+                             PERF_FLAG_FD_CLOEXEC);
+        }
+
+        pid = getpid();
+    }
+
+    // Read a counter, scaling its value, if it was multiplexed with
+    // other counters.
+
+    std::uint64_t read(const int i) {
+        std::uint64_t v[3];
+
+        if (fds[i] < 0
+            || ::read(fds[i], v, sizeof(v)) != sizeof(v)
+            || v[2] == 0) {
+            return unavailable;
+        }
+
+        if (v[2] < v[1]) {
+            return static_cast<std::uint64_t>(
+                static_cast<double>(v[0]) * v[1] / v[2]);
+        }
+
+        return v[0];
+    }
+};
+
+static thread_local Thread_counters counters;
+
+Event_measurement begin_event_measurement()
+{
+    Event_measurement m;
+
+    if (counters.pid != getpid()) {
+        counters.open();
+    }
+
+    for (int i = 0; i < event_counters_n; i++) {
+        m.counts[i] = counters.read(i);
+    }
+
+    return m;
+}
+
+std::vector<std::pair<const char *, std::uint64_t>> end_event_measurement(
+    const Event_measurement &m)
+{
+    std::vector<std::pair<const char *, std::uint64_t>> v;
+
+    for (int i = 0; i < event_counters_n; i++) {
+        const std::uint64_t n = counters.read(i);
+
+        if (n != unavailable && m.counts[i] != unavailable) {
+            v.emplace_back(
+                events[i].name, n > m.counts[i] ? n - m.counts[i] : 0);
+        }
+    }
+
+    return v;
+}
+
+#else
+
+Event_measurement begin_event_measurement()
+{
+    Event_measurement m;
+
+    for (std::uint64_t &n: m.counts) {
+        n = unavailable;
+    }
+
+    return m;
+}
+
+std::vector<std::pair<const char *, std::uint64_t>> end_event_measurement(
+    const Event_measurement &)
+{
+    return {};
+}
+
+#endif
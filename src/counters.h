@@ -0,0 +1,48 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hardware performance counters, counting events such as cycles,
+// cache misses and page faults, incurred by the calling thread
+// during an operation's evaluation, so that memory-bound operations
+// can be told apart from compute-bound ones.  Counters are opened
+// per thread, on first use, via perf_event_open(2) and are therefore
+// only available on Linux.  Events that aren't supported by the
+// (possibly virtual) hardware, or permitted by the system, are
+// omitted.
+
+constexpr int event_counters_n = 5;
+
+struct Event_measurement {
+    std::uint64_t counts[event_counters_n];
+};
+
+Event_measurement begin_event_measurement();
+
+// The events counted since the measurement began, as pairs of event
+// names and counts.
+
+std::vector<std::pair<const char *, std::uint64_t>> end_event_measurement(
+    const Event_measurement &m);
+
+#endif
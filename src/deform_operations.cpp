@@ -31,7 +31,7 @@ void Fair_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
     // Ensure mesh is triangulated.
 
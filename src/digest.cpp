@@ -0,0 +1,365 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SHA1_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)                                        \
+    && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#define SHA1_ARM
+#include <arm_neon.h>
+#endif
+
+#include "digest.h"
+
+typedef void (*Block_function)(
+    std::uint32_t *h, const std::uint8_t *p, std::size_t n);
+
+/////////////////////////////
+// Portable implementation //
+/////////////////////////////
+
+static inline std::uint32_t rotl32(std::uint32_t x, unsigned int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// Process n consecutive 64-byte blocks, keeping only the last 16
+// words of the message schedule.
+
+static void sha1_blocks_portable(
+    std::uint32_t *h, const std::uint8_t *p, std::size_t n)
+{
+    for (; n > 0; n--, p += 64) {
+        std::uint32_t w[16];
+
+        for (int i = 0; i < 16 ; i++) {
+            const std::uint8_t *q = p + i * 4;
+            w[i] = (static_cast<std::uint32_t>(q[0]) << 24
+                    | static_cast<std::uint32_t>(q[1]) << 16
+                    | static_cast<std::uint32_t>(q[2]) << 8
+                    | q[3]);
+        }
+
+        std::uint32_t a = h[0];
+        std::uint32_t b = h[1];
+        std::uint32_t c = h[2];
+        std::uint32_t d = h[3];
+        std::uint32_t e = h[4];
+
+        for (int i = 0; i < 80 ; i++) {
+            std::uint32_t f, k;
+
+            if (i >= 16) {
+                w[i & 15] = rotl32(w[(i + 13) & 15] ^ w[(i + 8) & 15]
+                                   ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+            }
+
+            if (i < 20) {
+                f = d ^ (b & (c ^ d));
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (d & (b | c));
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            const std::uint32_t g = rotl32(a, 5) + f + e + k + w[i & 15];
+
+            e = d;
+            d = c;
+            c = rotl32(b, 30);
+            b = a;
+            a = g;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+}
+
+/////////////////////////////
+// x86-64 SHA extensions   //
+/////////////////////////////
+
+#ifdef SHA1_X86
+
+// Each group of four rounds consumes four words of the message
+// schedule, while the schedule for later groups is computed in the
+// remaining registers.
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_blocks_x86(
+    std::uint32_t *h, const std::uint8_t *p, std::size_t n)
+{
+    const __m128i mask = _mm_set_epi64x(
+        0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_shuffle_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(h)), 0x1b);
+    __m128i e[2] = {_mm_set_epi32(h[4], 0, 0, 0), _mm_setzero_si128()};
+
+    for (; n > 0; n--, p += 64) {
+        const __m128i abcd_0 = abcd, e_0 = e[0];
+        __m128i m[4];
+
+        for (int i = 0; i < 4; i++) {
+            m[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(p + 16 * i)), mask);
+        }
+
+        e[0] = _mm_add_epi32(e[0], m[0]);
+        e[1] = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e[0], 0);
+
+#define GROUP(G, F)                                                     \
+        {                                                               \
+            __m128i &x = e[(G) & 1], &y = e[((G) + 1) & 1];             \
+            const __m128i &w = m[(G) & 3];                              \
+                                                                        \
+            x = _mm_sha1nexte_epu32(x, w);                              \
+            y = abcd;                                                   \
+                                                                        \
+            if ((G) >= 3 && (G) <= 18) {                                \
+                m[((G) + 1) & 3] = _mm_sha1msg2_epu32(m[((G) + 1) & 3], w); \
+            }                                                           \
+                                                                        \
+            abcd = _mm_sha1rnds4_epu32(abcd, x, F);                     \
+                                                                        \
+            if ((G) <= 16) {                                            \
+                m[((G) + 3) & 3] = _mm_sha1msg1_epu32(m[((G) + 3) & 3], w); \
+            }                                                           \
+                                                                        \
+            if ((G) >= 2 && (G) <= 17) {                                \
+                m[((G) + 2) & 3] = _mm_xor_si128(m[((G) + 2) & 3], w);  \
+            }                                                           \
+        }
+
+        GROUP(1, 0) GROUP(2, 0) GROUP(3, 0) GROUP(4, 0)
+        GROUP(5, 1) GROUP(6, 1) GROUP(7, 1) GROUP(8, 1) GROUP(9, 1)
+        GROUP(10, 2) GROUP(11, 2) GROUP(12, 2) GROUP(13, 2) GROUP(14, 2)
+        GROUP(15, 3) GROUP(16, 3) GROUP(17, 3) GROUP(18, 3) GROUP(19, 3)
+
+#undef GROUP
+
+        e[0] = _mm_sha1nexte_epu32(e[0], e_0);
+        abcd = _mm_add_epi32(abcd, abcd_0);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h),
+                     _mm_shuffle_epi32(abcd, 0x1b));
+    h[4] = _mm_extract_epi32(e[0], 3);
+}
+
+static bool has_sha_extensions()
+{
+    unsigned int a, b, c, d;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d)
+        || !(c & bit_SSE4_1) || !(c & bit_SSSE3)) {
+        return false;
+    }
+
+    return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA);
+}
+
+#endif
+
+/////////////////////////////
+// ARMv8 SHA extensions    //
+/////////////////////////////
+
+#ifdef SHA1_ARM
+
+static void sha1_blocks_arm(
+    std::uint32_t *h, const std::uint8_t *p, std::size_t n)
+{
+    const uint32x4_t k[4] = {
+        vdupq_n_u32(0x5a827999), vdupq_n_u32(0x6ed9eba1),
+        vdupq_n_u32(0x8f1bbcdc), vdupq_n_u32(0xca62c1d6)};
+
+    uint32x4_t abcd = vld1q_u32(h);
+    std::uint32_t e[2] = {h[4], 0};
+
+    for (; n > 0; n--, p += 64) {
+        const uint32x4_t abcd_0 = abcd;
+        const std::uint32_t e_0 = e[0];
+        uint32x4_t m[4], t[2];
+
+        for (int i = 0; i < 4; i++) {
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16 * i)));
+        }
+
+        t[0] = vaddq_u32(m[0], k[0]);
+        t[1] = vaddq_u32(m[1], k[0]);
+
+#define GROUP(G, F)                                                     \
+        {                                                               \
+            e[((G) + 1) & 1] = vsha1h_u32(vgetq_lane_u32(abcd, 0));     \
+            abcd = F(abcd, e[(G) & 1], t[(G) & 1]);                     \
+                                                                        \
+            if ((G) <= 17) {                                            \
+                t[(G) & 1] = vaddq_u32(m[((G) + 2) & 3], k[((G) + 2) / 5]); \
+            }                                                           \
+                                                                        \
+            if ((G) >= 1 && (G) <= 16) {                                \
+                m[((G) + 3) & 3] = vsha1su1q_u32(                       \
+                    m[((G) + 3) & 3], m[((G) + 2) & 3]);                \
+            }                                                           \
+                                                                        \
+            if ((G) <= 15) {                                            \
+                m[(G) & 3] = vsha1su0q_u32(                             \
+                    m[(G) & 3], m[((G) + 1) & 3], m[((G) + 2) & 3]);    \
+            }                                                           \
+        }
+
+        GROUP(0, vsha1cq_u32) GROUP(1, vsha1cq_u32) GROUP(2, vsha1cq_u32)
+        GROUP(3, vsha1cq_u32) GROUP(4, vsha1cq_u32)
+        GROUP(5, vsha1pq_u32) GROUP(6, vsha1pq_u32) GROUP(7, vsha1pq_u32)
+        GROUP(8, vsha1pq_u32) GROUP(9, vsha1pq_u32)
+        GROUP(10, vsha1mq_u32) GROUP(11, vsha1mq_u32) GROUP(12, vsha1mq_u32)
+        GROUP(13, vsha1mq_u32) GROUP(14, vsha1mq_u32)
+        GROUP(15, vsha1pq_u32) GROUP(16, vsha1pq_u32) GROUP(17, vsha1pq_u32)
+        GROUP(18, vsha1pq_u32) GROUP(19, vsha1pq_u32)
+
+#undef GROUP
+
+        e[0] += e_0;
+        abcd = vaddq_u32(abcd, abcd_0);
+    }
+
+    vst1q_u32(h, abcd);
+    h[4] = e[0];
+}
+
+#endif
+
+static Block_function select_implementation(const char **name)
+{
+#ifdef SHA1_X86
+    if (has_sha_extensions()) {
+        *name = "x86-64 SHA extensions";
+        return sha1_blocks_x86;
+    }
+#endif
+
+#ifdef SHA1_ARM
+    *name = "ARMv8 SHA extensions";
+    return sha1_blocks_arm;
+#endif
+
+    *name = "portable";
+    return sha1_blocks_portable;
+}
+
+// The implementation is selected upon first use, so that digests can
+// be safely computed during static initialization.
+
+static const char *implementation_name;
+
+static Block_function block_function()
+{
+    static const Block_function f =
+        select_implementation(&implementation_name);
+
+    return f;
+}
+
+const char *sha1_implementation()
+{
+    block_function();
+    return implementation_name;
+}
+
+static void sha1(const std::string &message, std::uint32_t *h)
+{
+    const std::uint8_t *s =
+        reinterpret_cast<const std::uint8_t *>(message.data());
+    const std::size_t n = message.size();
+
+    const Block_function sha1_blocks = block_function();
+
+    h[0] = 0x67452301;
+    h[1] = 0xefcdab89;
+    h[2] = 0x98badcfe;
+    h[3] = 0x10325476;
+    h[4] = 0xc3d2e1f0;
+
+    // Process all complete blocks in place, then pad the rest of the
+    // message with the terminating 1 bit, zeros and the message
+    // length, as 64bit big-endian, into one or two more blocks.
+
+    sha1_blocks(h, s, n / 64);
+
+    std::uint8_t buffer[128];
+    const std::size_t i = n % 64;
+    const std::size_t m = i < 56 ? 64 : 128;
+
+    memcpy(buffer, s + n - i, i);
+    buffer[i] = 0x80;
+    memset(buffer + i + 1, 0, m - i - 9);
+
+    for (std::uint64_t j = m - 1, l = n * 8; j >= m - 8; j--, l >>= 8) {
+        buffer[j] = l & 0xff;
+    }
+
+    sha1_blocks(h, buffer, m / 64);
+}
+
+std::string sha1digest(const std::string &message)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::uint32_t h[5];
+    char t[40];
+
+    sha1(message, h);
+
+    for (int i = 0; i < 40; i++) {
+        t[i] = digits[(h[i / 8] >> (28 - 4 * (i % 8))) & 0xf];
+    }
+
+    return std::string(t, 40);
+}
+
+std::string legacy_sha1digest(const std::string &message)
+{
+    std::uint32_t h[5];
+    char t[40], *q = t;
+
+    sha1(message, h);
+
+    for (const std::uint32_t x: h) {
+        q = std::to_chars(q, t + sizeof(t), x, 16).ptr;
+    }
+
+    return std::string(t, q);
+}
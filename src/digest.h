@@ -0,0 +1,38 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <string>
+
+// The SHA-1 digest of a message, in hex form, i.e. 40 hex digits.
+// The SHA instructions of x86-64 and ARMv8 are used, where available.
+
+std::string sha1digest(const std::string &message);
+
+// The digest in the form once used to name stored operations, with
+// each word written without leading zeros, so that it can be of any
+// length up to 40 digits.
+
+std::string legacy_sha1digest(const std::string &message);
+
+// The name of the implementation in use, e.g. for benchmarks.
+
+const char *sha1_implementation();
+
+#endif
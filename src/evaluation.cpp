@@ -15,30 +15,131 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
 #include <list>
+#include <queue>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <typeinfo>
 
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifndef _WIN32
+#include <csignal>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <CGAL/version_macros.h>
+
+#include "arena.h"
 #include "assertions.h"
 #include "options.h"
 #include "basic_operations.h"
+#include "cost_database.h"
+#include "heap.h"
 #include "kernel.h"
+#include "trace.h"
 
 namespace {
-    // Debugging information dump streams.
+    // A unit of evaluation, typically corresponding to an input file.
+    // Several units can be evaluated together, sharing the workers,
+    // but each unit has its own graph of operations, debugging
+    // information dumps and failure state.
 
-    std::mutex dump_mutex;
-    std::ostream operations_dump(nullptr), log_dump(nullptr),
-        graph_dump(nullptr);
+    struct Unit {
+        std::string name;
+        std::unordered_map<std::string, std::shared_ptr<Operation>> operations;
+
+        // The arena from which operations are allocated.  It's
+        // released along with the unit, or once the last of its
+        // operations is released, if they outlive it.
+
+        std::shared_ptr<Arena> arena;
+
+        // Debugging information dump streams.
+
+        std::filebuf operations_filebuf, log_filebuf, graph_filebuf;
+        std::ostream operations_dump, log_dump, graph_dump;
+
+        std::unordered_map<Operation *, std::string> tags;
+        int evaluation_sequence;
+
+        // Set after a fatal failure, to abandon the rest of the
+        // unit's operations and cancel those in flight.
+
+        std::atomic<bool> cancelled;
+        bool evaluated;
+
+        Unit(const char *s):
+            name(s ? s : "a"), arena(std::make_shared<Arena>()),
+            operations_dump(nullptr), log_dump(nullptr),
+            graph_dump(nullptr), evaluation_sequence(0), cancelled(false),
+            evaluated(false) {}
+
+        // Release the operations after their successors, so that
+        // releasing an operation never releases its operands in
+        // turn, which would exhaust the stack on long chains.
+
+        ~Unit() {
+            std::unordered_map<
+                Operation *,
+                std::pair<std::size_t, std::shared_ptr<Operation> *>> pending;
+            std::vector<Operation *> v;
+
+            for (auto &[k, x]: operations) {
+                pending[x.get()] = {x->successors.size(), &x};
+
+                if (x->successors.empty()) {
+                    v.push_back(x.get());
+                }
+            }
+
+            while (!v.empty()) {
+                Operation *op = v.back();
+                v.pop_back();
+
+                for (Operation *x: op->predecessors) {
+                    if (auto it = pending.find(x);
+                        it != pending.end() && --it->second.first == 0) {
+                        v.push_back(x);
+                    }
+                }
+
+                pending.at(op).second->reset();
+            }
+        }
+    };
+
+    // The units begun since the last evaluation, and the unit each
+    // operation under evaluation belongs to.
+
+    std::list<Unit> units;
+    std::unordered_map<const Operation *, Unit *> owners;
 
-    std::unordered_map<Operation *, std::string> tags;
-    int evaluation_sequence;
+    inline Unit &unit_of(const Operation *op)
+    {
+        return *owners.at(op);
+    }
+
+    std::mutex dump_mutex;
     std::chrono::time_point<std::chrono::steady_clock> evaluation_start;
 
     inline float evaluation_timestamp()
@@ -56,448 +157,1921 @@ namespace {
                        + "..."));
     }
 
-    // Ready queue
+    // Ready queues.  Ready operations are ordered by priority, i.e. by
+    // the estimated evaluation time of the longest chain of operations
+    // starting with them, so that operations on the critical path are
+    // dispatched first.  Ties are resolved in order of readiness.
 
-    std::list<Operation *> ready[2];
-    std::recursive_mutex ready_mutex;
-    std::condition_variable_any ready_condition;
+    struct Ready_entry {
+        float priority;
+        unsigned long sequence;
+        Operation *operation;
 
-    inline void ready_operation(Operation *op)
-    {
-        const Threadsafe_operation *p;
+        bool operator<(const Ready_entry &other) const {
+            return (priority < other.priority
+                    || (priority == other.priority
+                        && sequence > other.sequence));
+        }
+    };
 
-        ready[Options::threads > 0
-              && (p = dynamic_cast<Threadsafe_operation *>(op))
-              && p->threadsafe].push_front(op);
-    }
+    // Worker threads evaluate thread-safe operations.  Each worker
+    // places the operations made ready by the operations it evaluates
+    // on its own, local ready queue, and only turns to the global
+    // ready queue, or steals from the local queues of other workers,
+    // when that runs dry.  Local queues are ordered by priority as
+    // well, so that both their owner and any thieves take the most
+    // critical operation first.
+
+    class Worker {
+        int index;
+        std::thread thread;
+
+        // The local ready queue.  Since other workers can steal from
+        // it, it needs to be guarded, but contention should be low.
+
+        std::mutex queue_mutex;
+        std::priority_queue<Ready_entry> queue;
+
+        Operation *claim();
+        void work();
+
+    public:
+        Worker(int i): index(i) {};
+
+        void start() {
+            thread = std::thread(&Worker::work, this);
+        }
+
+        void join() {
+            thread.join();
+        }
 
-    bool had_failure = false;
+        void push(const Ready_entry &e);
+        Operation *take();
+    };
+
+    std::deque<Worker> workers;
+    thread_local Worker *current_worker;
+    int worker_threads;
 
-    bool try_dispatch_operation(Operation *op)
+    // Find the number of processors available to the process, taking
+    // its CPU affinity mask and any CPU quota imposed on its control
+    // group into account.
+
+    int available_processors()
     {
-        bool failed = true;
-        std::ostringstream s;
+        int n = std::thread::hardware_concurrency();
 
-        try {
-            try {
-                failed = op->dispatch();
-            } catch (const CGAL::Warning_exception &e) {
-                s << "CGAL warning"; throw;
-            } catch (const CGAL::Error_exception &e) {
-                s << "CGAL error"; throw;
-            } catch (const CGAL::Precondition_exception &e) {
-                s << "CGAL precondition violation"; throw;
-            } catch (const CGAL::Postcondition_exception &e) {
-                s << "CGAL postcondition violation"; throw;
-            } catch (const CGAL::Assertion_exception &e) {
-                s << "CGAL assertion violation"; throw;
-            } catch(const operation_warning_error &e) {
-                op->message(Operation::ERROR, e.what());
-            }
-        } catch(const CGAL::Failure_exception &e) {
-            std::string t;
+#ifdef __linux__
+        cpu_set_t s;
 
-            if (const std::string &p = e.expression(); !p.empty()) {
-                s << " '" << p << "'";
-            }
+        if (sched_getaffinity(0, sizeof(s), &s) == 0) {
+            n = CPU_COUNT(&s);
+        }
 
-            if (const std::string &m = e.message(); !m.empty()) {
-                s << " (" << m << ")";
-            }
+        // Try the cgroup v2 quota first, then fall back to v1.
 
-            op->message(Operation::ERROR, "evaluation of % failed due to a " + s.str());
+        long quota = -1, period = 0;
 
-            {
-                std::ostringstream t;
+        if (std::ifstream f("/sys/fs/cgroup/cpu.max"); f) {
+            std::string q;
 
-                t << e.filename() << ": " << std::to_string(e.line_number())
-                  << ": " << s.str();
+            if (f >> q >> period && q != "max") {
+                quota = std::stol(q);
+            }
+        } else {
+            std::ifstream g("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+            std::ifstream h("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
 
-                op->annotations.insert({"failure", t.str()});
+            if (!(g >> quota && h >> period)) {
+                quota = -1;
             }
-        } catch (const std::exception &e) {
-            s << " (" << e.what() << ")";
+        }
 
-            op->message(
-                Operation::ERROR, "evaluation of % failed due to an exception" + s.str());
+        if (quota > 0 && period > 0) {
+            n = std::min<long>(n, (quota + period - 1) / period);
         }
+#endif
 
-        return failed;
+        return std::max(n, 1);
     }
 
-    void dispatch_operation(Operation *op)
-    {
-        bool failed;
+    // Decide on the number of worker threads to use, when it has
+    // been left up to us.  The lazy exact kernel can only be shared
+    // across threads as of CGAL 5.5, so stick to serial evaluation
+    // with older versions.
 
-        if (Options::dump_graph
-            || Options::dump_operations
-            || Options::dump_log) {
-
-            // Assign an evaluation sequence number to the operation
-            // and find its tag.
+    int automatic_threads()
+    {
+#if CGAL_VERSION_NR < CGAL_VERSION_NUMBER(5, 5, 0)
+        return 0;
+#else
+        static const int n = available_processors();
 
-            dump_mutex.lock();
+        return n;
+#endif
+    }
 
-            auto it = tags.find(op);
-            const std::string &k = op->get_tag();
-            const std::string &l = (it == tags.end() ? k : it->second);
-            int n = evaluation_sequence++;
+    // Idle workers sleep until more operations become available, or
+    // the pool is drained.
 
-            // Replace tags of dependencies by their evaluation
-            // identifier for clarity. Replace in reverse order to
-            // ensure proper replacement, otherwise we would end up
-            // with
-            //
-            // $0 = rectangle(...)
-            // $1 = extrusion($0,...)
-            // $2 = mesh(extrusion($0,...))
-            //
-            // instead of
-            //
-            // $2 = mesh($1)
+    std::mutex idle_mutex;
+    std::condition_variable idle_condition;
+    std::atomic<int> available, sleeping;
+    bool draining;
 
-            if (Flags::dump_abridged_tags) {
-                for (Operation *x: op->successors) {
-                    if (!x->selected) {
-                        continue;
-                    }
+    // The global ready queues.  Queue [0] holds operations that must
+    // be evaluated in the main thread, while queue [1] holds
+    // thread-safe operations made ready outside of any worker, such
+    // as source operations.
 
-                    std::string &r = tags.insert({x, x->get_tag()}).first->second;
-                    const std::string s = std::string("$") + std::to_string(n);
+    std::priority_queue<Ready_entry> ready[2];
+    std::atomic<unsigned long> ready_sequence;
+    std::mutex ready_mutex;
+    std::condition_variable ready_condition;
 
-                    for (size_t i = r.find(k);
-                         i != std::string::npos;
-                         i = r.find(k, i)) {
-                        r.replace(i, k.size(), s);
-                    };
-                }
-            }
+    // The number of operations that are either ready, or under
+    // evaluation.  Evaluation has concluded when it drops to zero.
 
-            dump_mutex.unlock();
+    std::atomic<int> outstanding;
 
-            // Output pre-evaluation dumps.
+    // The number of ready operations, waiting to be dispatched.  It's
+    // only kept track of, for the purposes of tracing.
 
-            if (Options::dump_log) {
-                std::lock_guard<std::mutex> lock(dump_mutex);
+    std::atomic<int> waiting;
 
-                log_dump << evaluation_timestamp() << ": $" << n << " = "
-                         << maybe_shortened_tag(l) << " started" << std::endl;
-            }
+    inline void trace_waiting(int delta)
+    {
+        const int n = (waiting += delta);
 
-            if (Options::dump_operations) {
-                std::lock_guard<std::mutex> lock(dump_mutex);
+        if (tracing()) {
+            trace_counter("ready operations", n);
+        }
+    }
 
-                operations_dump << "$" << n << " = " << maybe_shortened_tag(l);
-                operations_dump.flush();
-            }
+    // Note a failure.  If failures are fatal, the rest of the unit's
+    // operations are abandoned and any of them currently under
+    // evaluation are cancelled, as their results are of no further
+    // use.  Evaluation halts once all units have been cancelled.
 
-            // Evaluate.
+    std::atomic<int> cancelled_units;
+    std::atomic<bool> halted;
 
-            failed = try_dispatch_operation(op);
+    inline void record_failure(Unit &u)
+    {
+        if (!Flags::warn_fatal_errors || u.cancelled.exchange(true)) {
+            return;
+        }
 
-            if (failed) {
-                op->annotations.insert({"failed", std::string()});
-            }
+        if (++cancelled_units == static_cast<int>(units.size())) {
+            halted = true;
+        }
+    }
 
-            // Output post-evaluation dumps.
+    // The memory occupied by the results of evaluated operations, as
+    // estimated by Operation::size().  The total is the memory that
+    // would be occupied, had no results been released.
 
-            if (Options::dump_log) {
-                std::lock_guard<std::mutex> lock(dump_mutex);
+    std::mutex memory_mutex;
+    std::unordered_map<Operation *, std::size_t> resident;
+    std::size_t resident_size, peak_resident_size, total_size;
 
-                log_dump << evaluation_timestamp()
-                         << ": $" << n
-                         << (failed ? " failed" : " concluded")
-                         << std::endl;
-            }
+    inline void trace_memory(std::size_t n)
+    {
+        if (tracing()) {
+            trace_counter("resident result memory (MB)", n / 1048576.0);
+        }
+    }
 
-            if (Options::dump_operations) {
-                std::lock_guard<std::mutex> lock(dump_mutex);
+    inline void account_operation(Operation *op)
+    {
+        const std::size_t n = op->size();
+        std::lock_guard<std::mutex> lock(memory_mutex);
 
-                if (Flags::dump_annotations && op->annotations.size() > 0) {
-                    operations_dump << " (";
+        resident.insert({op, n});
+        resident_size += n;
+        total_size += n;
+        peak_resident_size = std::max(peak_resident_size, resident_size);
 
-                    for (auto it = op->annotations.cbegin(); ;) {
-                        operations_dump << it->first;
+        trace_memory(resident_size);
+    }
 
-                        if (!it->second.empty()) {
-                            operations_dump << ": " << it->second;
-                        }
+    // Release the result of an operation, once all of its successors
+    // have been evaluated.
 
-                        if (++it == op->annotations.cend()) {
-                            break;
-                        }
+    inline void release_operation(Operation *op)
+    {
+        if (!op->disposable) {
+            return;
+        }
 
-                        operations_dump << ", ";
-                    }
+        op->release();
 
-                    operations_dump << ")";
-                }
+        {
+            std::lock_guard<std::mutex> lock(memory_mutex);
 
-                operations_dump << std::endl;
+            if (auto it = resident.find(op); it != resident.end()) {
+                resident_size -= it->second;
+                resident.erase(it);
             }
 
-            // Output Graphivz dot source for the evaluation graph.
+            trace_memory(resident_size);
+        }
 
-            if (Options::dump_graph) {
-                std::string r = maybe_shortened_tag(l);
+        if (Options::dump_log) {
+            Unit &u = unit_of(op);
+            std::lock_guard<std::mutex> lock(dump_mutex);
+            auto it = u.tags.find(op);
+            const std::string &m =
+                (it == u.tags.end() ? op->describe() : it->second);
 
-                // Escape double quotes.
+            u.log_dump << evaluation_timestamp()
+                       << ": " << maybe_shortened_tag(m)
+                       << " released" << std::endl;
+        }
+    }
 
-                for (size_t p = r.find('"');
-                     p != std::string::npos;
-                     p = r.find('"', p + 2)) {
-                    r.replace(p, 1, "\\\"");
-                };
+    inline bool is_threadsafe(Operation *op)
+    {
+        const Threadsafe_operation *p =
+            dynamic_cast<Threadsafe_operation *>(op);
 
-                // Add the node.
+        return p && p->threadsafe;
+    }
 
-                std::lock_guard<std::mutex> lock(dump_mutex);
+    // Whether an operation can be evaluated in a child process,
+    // which requires that its result can be transferred.
 
-                graph_dump << "\"" << op->digest() << "\" "
-                           << "[label=\"<head>$" << n << "|";
+    inline bool qualifies_for_process(Operation *op)
+    {
+        return (Flags::evaluate
+                && !is_threadsafe(op)
+                && !op->loadable
+                && !op->cached
+                && op->transferable());
+    }
 
-                if (Flags::dump_annotations && op->annotations.size() > 0) {
-                    graph_dump << "{" << r << "|";
+    // A pool of I/O threads loads and stores operations, so that
+    // parsing, serialization and compression can take place in
+    // parallel and, in the case of stores, off the critical path.
+    //
+    // Loadable source operations are prefetched as soon as selection
+    // concludes, in order of priority, and their successors are made
+    // ready as usual.  A pending store counts as a consumer of the
+    // operation's result, so that it is neither released, nor taken
+    // over by a successor, before it has been stored.  Loads take
+    // precedence over stores, as other operations depend on them.
+
+    void dispatch_operation(Operation *op);
+    void conclude_operation();
+    void dump_operation(
+        Unit &u, Operation *op, const int n, const std::string &l);
+
+    // Stores in the background defer the dumps following the
+    // evaluation of the operation (if any), so that they reflect the
+    // outcome of the store.
+
+    struct Pending_store {
+        Operation *operation;
+        int sequence;
+        std::string tag;
+    };
 
-                    for (auto it = op->annotations.cbegin(); ;) {
-                        graph_dump << it->first;
+    std::mutex io_mutex;
+    std::condition_variable io_condition;
+    std::priority_queue<Ready_entry> load_queue;
+    std::queue<Pending_store> store_queue;
+    std::vector<std::thread> io_threads;
+    bool io_draining;
 
-                        if (!it->second.empty()) {
-                            graph_dump << ": " << it->second;
-                        }
+    // The digests of the operations stored during evaluation.
+    // Identical operations of different units needn't be stored
+    // twice (and mustn't be stored concurrently).
 
-                        if (++it == op->annotations.cend()) {
-                            break;
-                        }
+    std::unordered_set<std::string> stores;
 
-                        graph_dump << ", ";
-                    }
+    // The tag of an operation, as it appears in traces, i.e. abridged
+    // if the tags of its predecessors have been substituted.
 
-                    graph_dump << "\\l}";
-                } else {
-                    graph_dump << r;
-                }
+    std::string trace_name(Unit &u, Operation *op)
+    {
+        std::lock_guard<std::mutex> lock(dump_mutex);
+        auto it = u.tags.find(op);
 
-                graph_dump << "\"]" << std::endl;
+        return maybe_shortened_tag(
+            it == u.tags.end() ? op->describe() : it->second);
+    }
 
-                // Add its edges.
+    void store_operation(Operation *op)
+    {
+        Unit &u = unit_of(op);
+        const auto t_0 = Trace_clock::now();
 
-                if (op->successors.size() > 0) {
+        // Annotations are only modified under the dump lock, as the
+        // operation might be stored in the background.
 
-                    graph_dump << "\"" << op->digest() << "\":head -> {";
+        try {
+            if (op->try_store()) {
+                std::lock_guard<std::mutex> lock(dump_mutex);
 
-                    for (Operation *x: op->successors) {
-                        if (!x->selected) {
-                            continue;
-                        }
+                op->annotations.insert({"stored", op->get_store_path()});
 
-                        graph_dump << "\"" << x->digest() << "\" ";
-                    }
+                if (Options::dump_log) {
+                    auto it = u.tags.find(op);
+                    const std::string &m =
+                        (it == u.tags.end() ? op->describe() : it->second);
 
-                    graph_dump << "}\n" << std::endl;
+                    u.log_dump << evaluation_timestamp()
+                               << ": " << maybe_shortened_tag(m)
+                               << " stored" << std::endl;
                 }
             }
-        } else {
-            failed = try_dispatch_operation(op);
+        } catch (const operation_warning_error &e) {
+            op->message(Operation::ERROR, e.what());
+            record_failure(u);
+        } catch (const std::exception &e) {
+            op->message(
+                Operation::ERROR,
+                std::string("storing of % failed (") + e.what() + ")");
+            record_failure(u);
         }
 
-        // Update the successors and ready list.
+        if (tracing()) {
+            trace_span("store", trace_name(u, op), t_0, Trace_clock::now());
+        }
+    }
 
-        {
-            std::lock_guard<std::recursive_mutex> lock(ready_mutex);
-
-            // We use the ready mutex to guard against multiple
-            // workers racing to update the same successor and/or
-            // the ready queue.
-
-            if (!failed) {
-                if (Flags::warn_unused
-                    && op->successors.empty()
-                    && !dynamic_cast<Sink_operation *>(op)) {
-                    op->message(
-                        Operation::WARNING,
-                        "operation % instantiated but not used");
-                }
+    void work_io(int i)
+    {
+        trace_thread(1001 + i, "I/O " + std::to_string(i));
 
-                for (Operation *x: op->successors) {
-                    if (!x->selected) {
-                        continue;
-                    }
+        while (true) {
+            Operation *op;
+            Pending_store x;
+            bool load;
 
-                    x->cost += op->cost;
-                    x->predecessors.erase(op);
+            {
+                std::unique_lock<std::mutex> lock(io_mutex);
+
+                io_condition.wait(lock, [] {
+                    return (io_draining
+                            || !load_queue.empty()
+                            || !store_queue.empty());
+                });
+
+                if ((load = !load_queue.empty())) {
+                    op = load_queue.top().operation;
+                    load_queue.pop();
+                } else if (!store_queue.empty()) {
+                    x = std::move(store_queue.front());
+                    op = x.operation;
+                    store_queue.pop();
+                } else {
+                    return;
+                }
+            }
 
-                    if (x->predecessors.empty()) {
-                        ready_operation(x);
+            if (!load) {
+                store_operation(op);
 
-                        if (Options::dump_log) {
-                            std::lock_guard<std::mutex> lock(dump_mutex);
-                            auto it = tags.find(x);
-                            const std::string &m =
-                                (it == tags.end() ? x->get_tag() : it->second);
+                if (x.sequence >= 0) {
+                    dump_operation(unit_of(op), op, x.sequence, x.tag);
+                }
 
-                            log_dump << evaluation_timestamp()
-                                     << ": " << maybe_shortened_tag(m)
-                                     << " ready" << std::endl;
-                        }
-                    }
+                if (--op->consumers == 0) {
+                    release_operation(op);
                 }
             } else {
-                had_failure = true;
+                // Abandon pending loads after a fatal error, but
+                // still conclude them, so that evaluation can.
+
+                if (!unit_of(op).cancelled) {
+                    op->annotations.insert({"thread", "io"});
+                    dispatch_operation(op);
+                }
+
+                conclude_operation();
             }
         }
     }
 
-    class Worker {
-        int index;
-        std::thread thread;
-
-        // These guard transitions of 'pending', i.e. work assignment and
-        // conclusion.
+    // Store an evaluated operation, in the background if possible.
+    // Thread-unsafe operations are stored in the evaluating thread.
+    // Returns whether the store was deferred to the background, in
+    // which case the dumps for the operation's evaluation, given its
+    // sequence number and tag, are output once it's complete.
 
-        std::mutex pending_mutex;
-        std::condition_variable pending_condition;
+    bool schedule_store(Operation *op, const int n, const std::string &l)
+    {
+        {
+            std::lock_guard<std::mutex> lock(io_mutex);
 
-        Operation *pending;         // Work under, or pending for, evaluation.
-        bool draining;              // Worker is winding down.
+            if (!stores.insert(op->digest()).second) {
+                return false;
+            }
+        }
 
-        void work();
+        if (io_threads.empty() || !is_threadsafe(op)) {
+            store_operation(op);
+            return false;
+        }
 
-    public:
-        Worker(int i): index(i), pending(nullptr), draining(false) {};
+        op->consumers++;
 
-        void start() {
-            thread = std::thread(&Worker::work, this);
+        {
+            std::lock_guard<std::mutex> lock(io_mutex);
+            store_queue.push({op, n, l});
         }
 
-        void stop();
-        bool evaluate(Operation *op);
-    };
-}
+        io_condition.notify_one();
 
-void Worker::stop()
-{
-    assert (thread.joinable());
+        return true;
+    }
+
+    // Load a loadable source operation in the background, if
+    // possible, or place it on the ready queues otherwise.
 
+    void ready_operation(Operation *op);
+
+    void prefetch_operation(Operation *op)
     {
-        std::lock_guard<std::mutex> lock(pending_mutex);
-        draining = true;
-        pending_condition.notify_one();
-    }
+        if (io_threads.empty() || !op->loadable || !is_threadsafe(op)) {
+            ready_operation(op);
+            return;
+        }
 
-    thread.join();
-}
+        outstanding++;
 
-bool Worker::evaluate(Operation *op)
-{
-    std::lock_guard<std::mutex> lock(pending_mutex);
+        {
+            std::lock_guard<std::mutex> lock(io_mutex);
+            load_queue.push({op->priority, ready_sequence++, op});
+        }
 
-    if (pending) {
-        return false;
+        io_condition.notify_one();
     }
 
-    assert(!pending);
-    if (op) {
-        pending = op;
-        pending_condition.notify_one();
-    }
+    void ready_operation(Operation *op)
+    {
+        const Ready_entry e = {op->priority, ready_sequence++, op};
 
-    return true;
-}
+        outstanding++;
+        trace_waiting(1);
 
-void Worker::work()
-{
-    std::unique_lock<std::mutex> lock(pending_mutex);
+        if (worker_threads > 0 && is_threadsafe(op)) {
+            if (current_worker) {
+                current_worker->push(e);
+            } else {
+                std::lock_guard<std::mutex> lock(ready_mutex);
+                ready[1].push(e);
+            }
 
-    while (true) {
-        while (!(draining || pending)) {
-            pending_condition.wait(lock);
+            available++;
+
+            if (sleeping > 0) {
+                std::lock_guard<std::mutex> lock(idle_mutex);
+                idle_condition.notify_one();
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+
+            ready[0].push(e);
+            ready_condition.notify_one();
         }
+    }
 
-        if (draining) {
-            break;
+    inline Operation *next_ready_operation(int i)
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex);
+
+        if (ready[i].empty()) {
+            return nullptr;
         }
 
-        pending->annotations.insert({"thread", std::to_string(index)});
+        Operation *op = ready[i].top().operation;
+        ready[i].pop();
 
-        lock.unlock();
-        dispatch_operation(pending);
-        lock.lock();
+        return op;
+    }
+
+    // Called once an operation has been dispatched and its successors
+    // have been updated.
 
-        pending = nullptr;
-        ready_condition.notify_one();
+    void conclude_operation()
+    {
+        if (--outstanding == 0 || halted) {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            ready_condition.notify_one();
+        }
     }
-}
 
-////////////////
-// Operations //
-////////////////
+    bool try_dispatch_operation(Unit &u, Operation *op)
+    {
+        bool failed = true;
+        std::ostringstream s;
 
-#include "polygon_operations.h"
-#include "polyhedron_operations.h"
-#include "circle_polygon_types.h"
-#include "conic_polygon_types.h"
-#include "evaluation.h"
+        Operation::cancellation = &u.cancelled;
+
+        try {
+            try {
+                failed = op->dispatch();
+            } catch (const CGAL::Warning_exception &e) {
+                s << "CGAL warning"; throw;
+            } catch (const CGAL::Error_exception &e) {
+                s << "CGAL error"; throw;
+            } catch (const CGAL::Precondition_exception &e) {
+                s << "CGAL precondition violation"; throw;
+            } catch (const CGAL::Postcondition_exception &e) {
+                s << "CGAL postcondition violation"; throw;
+            } catch (const CGAL::Assertion_exception &e) {
+                s << "CGAL assertion violation"; throw;
+            } catch(const operation_warning_error &e) {
+                op->message(Operation::ERROR, e.what());
+            } catch(const operation_cancelled &e) {
+                op->annotations.insert({"cancelled", "true"});
+            }
+        } catch(const CGAL::Failure_exception &e) {
+            std::string t;
+
+            if (const std::string &p = e.expression(); !p.empty()) {
+                s << " '" << p << "'";
+            }
+
+            if (const std::string &m = e.message(); !m.empty()) {
+                s << " (" << m << ")";
+            }
+
+            op->message(Operation::ERROR, "evaluation of % failed due to a " + s.str());
+
+            {
+                std::ostringstream t;
+
+                t << e.filename() << ": " << std::to_string(e.line_number())
+                  << ": " << s.str();
+
+                op->annotations.insert({"failure", t.str()});
+            }
+        } catch (const std::exception &e) {
+            s << " (" << e.what() << ")";
+
+            op->message(
+                Operation::ERROR, "evaluation of % failed due to an exception" + s.str());
+        }
+
+        Operation::cancellation = nullptr;
+
+        return failed;
+    }
+
+    // Output the dumps preceding the evaluation of an operation.
+    // Returns its evaluation sequence number and its (possibly
+    // abridged) tag, for use in the dumps following the evaluation,
+    // or -1, if no dumps are requested.
+
+    int begin_dispatch(Unit &u, Operation *op, std::string &l)
+    {
+        if (!Options::dump_graph
+            && !Options::dump_operations
+            && !Options::dump_log) {
+            return -1;
+        }
+
+        // Assign an evaluation sequence number to the operation
+        // and find its tag.
+
+        dump_mutex.lock();
+
+        // The abridged tag is copied, so that it can be safely
+        // used outside the lock below.
+
+        auto it = u.tags.find(op);
+        const std::string k = op->describe();
+        int n = u.evaluation_sequence++;
+
+        l = (it == u.tags.end() ? k : it->second);
+
+        // Replace tags of dependencies by their evaluation
+        // identifier for clarity. Replace in reverse order to
+        // ensure proper replacement, otherwise we would end up
+        // with
+        //
+        // $0 = rectangle(...)
+        // $1 = extrusion($0,...)
+        // $2 = mesh(extrusion($0,...))
+        //
+        // instead of
+        //
+        // $2 = mesh($1)
+
+        if (Flags::dump_abridged_tags) {
+            for (Operation *x: op->successors) {
+                if (!x->selected) {
+                    continue;
+                }
+
+                std::string &r = u.tags[x];
+                const std::string s = std::string("$") + std::to_string(n);
+
+                if (r.empty()) {
+                    r = x->describe();
+                }
+
+                for (size_t i = r.find(k);
+                     i != std::string::npos;
+                     i = r.find(k, i)) {
+                    r.replace(i, k.size(), s);
+                };
+            }
+        }
+
+        dump_mutex.unlock();
+
+        // Output pre-evaluation dumps.
+
+        if (Options::dump_log) {
+            std::lock_guard<std::mutex> lock(dump_mutex);
+
+            u.log_dump << evaluation_timestamp() << ": $" << n << " = "
+                       << maybe_shortened_tag(l) << " started" << std::endl;
+        }
+
+        if (Options::dump_operations) {
+            std::lock_guard<std::mutex> lock(dump_mutex);
+
+            u.operations_dump << "$" << n << " = " << maybe_shortened_tag(l);
+            u.operations_dump.flush();
+        }
+
+        return n;
+    }
+
+    // Output the operations and graph dumps following the evaluation
+    // of an operation.
+
+    void dump_operation(
+        Unit &u, Operation *op, const int n, const std::string &l)
+    {
+        if (Options::dump_operations) {
+            std::lock_guard<std::mutex> lock(dump_mutex);
+
+            if (Flags::dump_annotations && op->annotations.size() > 0) {
+                u.operations_dump << " (";
+
+                for (auto it = op->annotations.cbegin(); ;) {
+                    u.operations_dump << it->first;
+
+                    if (!it->second.empty()) {
+                        u.operations_dump << ": " << it->second;
+                    }
+
+                    if (++it == op->annotations.cend()) {
+                        break;
+                    }
+
+                    u.operations_dump << ", ";
+                }
+
+                u.operations_dump << ")";
+            }
+
+            u.operations_dump << std::endl;
+        }
+
+        // Output Graphivz dot source for the evaluation graph.
+
+        if (Options::dump_graph) {
+            std::string r = maybe_shortened_tag(l);
+
+            // Escape double quotes.
+
+            for (size_t p = r.find('"');
+                 p != std::string::npos;
+                 p = r.find('"', p + 2)) {
+                r.replace(p, 1, "\\\"");
+            };
+
+            // Add the node.
+
+            std::lock_guard<std::mutex> lock(dump_mutex);
+
+            u.graph_dump << "\"" << op->digest() << "\" "
+                       << "[label=\"<head>$" << n << "|";
+
+            if (Flags::dump_annotations && op->annotations.size() > 0) {
+                u.graph_dump << "{" << r << "|";
+
+                for (auto it = op->annotations.cbegin(); ;) {
+                    u.graph_dump << it->first;
+
+                    if (!it->second.empty()) {
+                        u.graph_dump << ": " << it->second;
+                    }
+
+                    if (++it == op->annotations.cend()) {
+                        break;
+                    }
+
+                    u.graph_dump << ", ";
+                }
+
+                u.graph_dump << "\\l}";
+            } else {
+                u.graph_dump << r;
+            }
+
+            u.graph_dump << "\"]" << std::endl;
+
+            // Add its edges.
+
+            if (op->successors.size() > 0) {
+
+                u.graph_dump << "\"" << op->digest() << "\":head -> {";
+
+                for (Operation *x: op->successors) {
+                    if (!x->selected) {
+                        continue;
+                    }
+
+                    u.graph_dump << "\"" << x->digest() << "\" ";
+                }
+
+                u.graph_dump << "}\n" << std::endl;
+            }
+        }
+    }
+
+    // Output the dumps following the evaluation of an operation and,
+    // unless it failed, update its successors and the ready list.
+
+    void finish_dispatch(Unit &u, Operation *op, const int n,
+                         const std::string &l, const bool failed)
+    {
+        if (n >= 0) {
+            if (failed) {
+                op->annotations.insert({"failed", std::string()});
+            }
+
+            // Output post-evaluation dumps.
+
+            if (Options::dump_log) {
+                std::lock_guard<std::mutex> lock(dump_mutex);
+
+                u.log_dump << evaluation_timestamp()
+                           << ": $" << n
+                           << (failed ? " failed" : " concluded")
+                           << std::endl;
+            }
+        }
+
+        // Operations stored in the background are dumped once
+        // stored.
+
+        bool deferred = false;
+
+        if (!failed) {
+            account_operation(op);
+            deferred = op->storable && schedule_store(op, n, l);
+        }
+
+        if (n >= 0 && !deferred) {
+            dump_operation(u, op, n, l);
+        }
+
+        // Update the successors and ready list.
+
+        if (!failed) {
+            // Release the results of predecessors that are no longer
+            // needed.
+
+            for (Operation *x: op->predecessors) {
+                if (--x->consumers == 0) {
+                    release_operation(x);
+                }
+            }
+
+            if (Flags::warn_unused
+                && op->successors.empty()
+                && !dynamic_cast<Sink_operation *>(op)) {
+                op->message(
+                    Operation::WARNING,
+                    "operation % instantiated but not used");
+            }
+
+            for (Operation *x: op->successors) {
+                if (!x->selected) {
+                    continue;
+                }
+
+                // The last predecessor to conclude makes the
+                // successor ready, so that there's no need to guard
+                // the update.
+
+                if (--x->pending > 0) {
+                    continue;
+                }
+
+                for (Operation *y: x->predecessors) {
+                    x->cost += y->cost;
+                }
+
+                if (Options::dump_log) {
+                    std::lock_guard<std::mutex> lock(dump_mutex);
+                    auto it = u.tags.find(x);
+                    const std::string &m =
+                        (it == u.tags.end() ? x->describe() : it->second);
+
+                    u.log_dump << evaluation_timestamp()
+                               << ": " << maybe_shortened_tag(m)
+                               << " ready" << std::endl;
+                }
+
+                ready_operation(x);
+            }
+        } else {
+            record_failure(u);
+        }
+    }
+
+    // Trace the evaluation of an operation, as a span on the given
+    // track, tied to the spans of its predecessors and successors by
+    // flows.
+
+    void trace_operation(Unit &u, Operation *op, int track,
+                         Trace_clock::time_point t_0,
+                         Trace_clock::time_point t_1)
+    {
+        auto flow = [](Operation *x, Operation *y) {
+            std::ostringstream s;
+
+            s << x << "-" << y;
+            return s.str();
+        };
+
+        for (Operation *x: op->predecessors) {
+            trace_flow(track, false, flow(x, op), t_0);
+        }
+
+        trace_span(track, "operation", trace_name(u, op), t_0, t_1,
+                   op->annotations);
+
+        for (Operation *x: op->successors) {
+            if (x->selected) {
+                trace_flow(track, true, flow(op, x), t_1);
+            }
+        }
+    }
+
+    void dispatch_operation(Operation *op)
+    {
+        Unit &u = unit_of(op);
+
+        // Abandon the operations of cancelled units.
+
+        if (u.cancelled) {
+            return;
+        }
+
+        std::string l;
+        const int n = begin_dispatch(u, op, l);
+        const auto t_0 = Trace_clock::now();
+        const bool failed = try_dispatch_operation(u, op);
+
+        if (tracing()) {
+            trace_operation(
+                u, op, current_trace_track(), t_0, Trace_clock::now());
+        }
+
+        finish_dispatch(u, op, n, l, failed);
+    }
+
+#ifndef _WIN32
+    // Operations that can't be evaluated in worker threads, can
+    // instead be evaluated in child processes, so that they can be
+    // evaluated in parallel, while a crash during their evaluation
+    // only fails the operation.  A pool of processes is forked at
+    // the start of evaluation, before any other threads are started,
+    // so that the children inherit the graph of operations, but none
+    // of the locks that threads might hold.  Operations are then
+    // delegated to idle processes, as they become ready, over a pipe.
+    // Results, as well as the operands of delegated operations, are
+    // transferred between processes via temporary files in the store
+    // format, so that only operations with storable results qualify,
+    // while the outcome of the evaluation, along with its costs and
+    // annotations, is reported over another pipe.
+
+    struct Process {
+        pid_t pid;
+        int requests, reports, slot;
+        bool signalled;
+        Operation *operation;   // Under evaluation, if any.
+        int sequence;
+        std::string tag, report;
+        Trace_clock::time_point start;
+    };
+
+    std::list<Process> processes;
+    std::filesystem::path transfer_directory;
+    void (*sigpipe_handler)(int);
+
+    // The digests of the operations transferred so far, the results
+    // of which can be found in the transfer directory.
+
+    std::unordered_set<std::string> transferred;
+
+    inline std::string transfer_path(Operation *op)
+    {
+        return (transfer_directory / (op->digest() + ".o")).string();
+    }
+
+    // Results are first transferred to a path particular to the
+    // evaluating process, as structurally identical operations (of
+    // different units, say) may be evaluated concurrently.
+
+    inline std::string transfer_path(Operation *op, pid_t pid)
+    {
+        return (transfer_directory
+                / (op->digest() + "." + std::to_string(pid) + ".o")).string();
+    }
+
+    // Requests and reports consist of fields, each prefixed by its
+    // length, and are themselves sent as a single field.
+
+    void append_field(std::string &s, const std::string &x)
+    {
+        s += std::to_string(x.size());
+        s += ':';
+        s += x;
+    }
+
+    std::vector<std::string> parse_report(const std::string &s)
+    {
+        std::vector<std::string> v;
+
+        for (std::size_t i = 0, j; i < s.size(); i = j + 1) {
+            if ((j = s.find(':', i)) == std::string::npos) {
+                break;
+            }
+
+            const std::size_t n = std::stoul(s.substr(i, j - i));
+
+            if (j + n >= s.size()) {
+                break;
+            }
+
+            v.push_back(s.substr(j + 1, n));
+            j += n;
+        }
+
+        return v;
+    }
+
+    // Extract a complete message from the front of a buffer, if it
+    // contains one.
+
+    bool extract_message(std::string &s, std::string &m)
+    {
+        const std::size_t j = s.find(':');
+
+        if (j == std::string::npos) {
+            return false;
+        }
+
+        const std::size_t n = std::stoul(s.substr(0, j));
+
+        if (s.size() < j + 1 + n) {
+            return false;
+        }
+
+        m = s.substr(j + 1, n);
+        s.erase(0, j + 1 + n);
+
+        return true;
+    }
+
+    bool write_message(int fd, const std::string &x)
+    {
+        std::string s;
+
+        append_field(s, x);
+
+        for (std::size_t i = 0; i < s.size();) {
+            const ssize_t n = write(fd, s.data() + i, s.size() - i);
+
+            if (n < 0 && errno != EINTR) {
+                return false;
+            }
+
+            i += std::max<ssize_t>(n, 0);
+        }
+
+        return true;
+    }
+
+    // Read a message, blocking until it has arrived in full.  The
+    // length prefix is read byte by byte, so as not to read past it.
+
+    bool read_message(int fd, std::string &s)
+    {
+        std::string t;
+        char c;
+
+        while (true) {
+            const ssize_t n = read(fd, &c, 1);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return false;
+            }
+
+            if (c == ':') {
+                break;
+            }
+
+            t += c;
+        }
+
+        s.resize(std::stoul(t));
+
+        for (std::size_t i = 0; i < s.size();) {
+            const ssize_t n = read(fd, s.data() + i, s.size() - i);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return false;
+            }
+
+            i += n;
+        }
+
+        return true;
+    }
+
+    // The cancellation flag of the unit of the operation under
+    // evaluation in the child process, set upon SIGUSR1, once the
+    // parent has cancelled the unit.
+
+    std::atomic<std::atomic<bool> *> child_cancellation;
+
+    void cancel_in_child(int)
+    {
+        if (std::atomic<bool> *p = child_cancellation.load()) {
+            p->store(true);
+        }
+    }
+
+    // Evaluate an operation in the child process and return the
+    // report.  Its operands are loaded, if they were transferred, or
+    // evaluated anew otherwise, along with any of their own operands
+    // that weren't transferred, in a depth-first walk of the graph.
+    // The results are released afterwards, as the process will go on
+    // to evaluate other operations.  If the operands can't be
+    // obtained, the operation is reported as neither failed, nor
+    // stored, so that the parent evaluates it instead.
+
+    std::string evaluate_in_child(
+        Operation *op, const std::unordered_set<Operation *> &operands)
+    {
+        Unit &u = unit_of(op);
+        std::unordered_set<Operation *> visited;
+        std::vector<Operation *> w;
+        std::vector<std::pair<Operation *, bool>> stack;
+        bool loaded = true;
+
+        for (Operation *x: op->predecessors) {
+            stack.push_back({x, false});
+        }
+
+        child_cancellation = &u.cancelled;
+
+        while (loaded && !stack.empty()) {
+            auto [x, expanded] = stack.back();
+            stack.pop_back();
+
+            if (expanded) {
+                loaded = !try_dispatch_operation(unit_of(x), x);
+                w.push_back(x);
+            } else if (x->cached || !visited.insert(x).second) {
+                continue;
+            } else if (operands.count(x) > 0) {
+                loaded = x->load_from(transfer_path(x));
+                w.push_back(x);
+            } else {
+                stack.push_back({x, true});
+
+                for (Operation *y: x->predecessors) {
+                    stack.push_back({y, false});
+                }
+            }
+        }
+
+        op->annotations.clear();
+
+        const bool failed = loaded && try_dispatch_operation(u, op);
+        const bool stored = (loaded && !failed
+                             && op->store_to(transfer_path(op, getpid())));
+        const Operation_costs c = find_operation_costs(op->digest());
+        std::string s;
+
+        append_field(s, std::to_string(failed));
+        append_field(s, std::to_string(stored));
+        append_field(s, std::to_string(op->cost));
+        append_field(s, std::to_string(op->storable));
+        append_field(s, std::to_string(c.evaluation_time));
+        append_field(s, std::to_string(c.memory));
+
+        for (const auto &[k, v]: op->annotations) {
+            append_field(s, k);
+            append_field(s, v);
+        }
+
+        op->release();
+
+        for (Operation *x: w) {
+            x->release();
+        }
+
+        return s;
+    }
+
+    // Serve requests in the child process, until the parent closes
+    // the pipe.  Each request consists of the address of the
+    // operation (which is the same in the child, as in the parent),
+    // its cost so far and the addresses of the operations that have
+    // been transferred for it.  The child exits without unwinding, as
+    // its state (e.g. the cost database) belongs to the parent.
+
+    [[noreturn]] void serve_requests(int in, int out)
+    {
+        struct sigaction a = {};
+
+        a.sa_handler = cancel_in_child;
+        sigaction(SIGUSR1, &a, nullptr);
+
+        abandon_trace();
+
+        for (std::string s; read_message(in, s);) {
+            const std::vector<std::string> v = parse_report(s);
+            auto address = [](const std::string &x) {
+                return reinterpret_cast<Operation *>(
+                    static_cast<std::uintptr_t>(std::stoull(x)));
+            };
+
+            std::unordered_set<Operation *> operands;
+            Operation *op = address(v.at(0));
+
+            op->cost = std::stof(v.at(1));
+
+            for (std::size_t i = 2; i < v.size(); i++) {
+                operands.insert(address(v[i]));
+            }
+
+            if (!write_message(out, evaluate_in_child(op, operands))) {
+                break;
+            }
+        }
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    // Fork the pool of processes.  This must take place before any
+    // other threads are started.
+
+    void start_processes()
+    {
+        if (Options::processes <= 0 || !Flags::evaluate) {
+            return;
+        }
+
+        std::string s = (std::filesystem::temp_directory_path()
+                         / "gamma-XXXXXX").string();
+
+        if (!mkdtemp(s.data())) {
+            return;
+        }
+
+        transfer_directory = s;
+
+        // Don't let a process that has crashed take the parent down
+        // with it, when a request is sent its way.
+
+        sigpipe_handler = std::signal(SIGPIPE, SIG_IGN);
+
+        for (int i = 0; i < Options::processes; i++) {
+            int a[2], b[2];
+
+            if (pipe(a) < 0) {
+                break;
+            }
+
+            if (pipe(b) < 0) {
+                close(a[0]);
+                close(a[1]);
+
+                break;
+            }
+
+            const pid_t pid = fork();
+
+            if (pid == 0) {
+                close(a[1]);
+                close(b[0]);
+
+                for (const Process &p: processes) {
+                    close(p.requests);
+                    close(p.reports);
+                }
+
+                serve_requests(a[0], b[1]);
+            }
+
+            close(a[0]);
+            close(b[1]);
+
+            if (pid < 0) {
+                close(a[1]);
+                close(b[0]);
+
+                break;
+            }
+
+            Process &p = processes.emplace_back();
+
+            p.pid = pid;
+            p.requests = a[1];
+            p.reports = b[0];
+            p.slot = i;
+            p.signalled = false;
+            p.operation = nullptr;
+        }
+    }
+
+    // Delegate an operation to an idle process if it qualifies,
+    // returning whether it was delegated.  Operands are transferred
+    // once, before the first operation that needs them is delegated.
+    // Those that can't be (as well as operations further up the
+    // graph, which may have been released in the meantime) are
+    // evaluated anew in the child, unless they were transferred
+    // before.
+
+    bool delegate_operation(Operation *op)
+    {
+        auto it = std::find_if(processes.begin(), processes.end(),
+                               [](const Process &p) {
+                                   return !p.operation;
+                               });
+
+        if (it == processes.end()
+            || !qualifies_for_process(op)
+            || unit_of(op).cancelled) {
+            return false;
+        }
+
+        Process &p = *it;
+        std::unordered_set<Operation *> visited;
+        std::vector<Operation *> stack(
+            op->predecessors.begin(), op->predecessors.end());
+        std::string s;
+
+        append_field(
+            s, std::to_string(reinterpret_cast<std::uintptr_t>(op)));
+        append_field(s, std::to_string(op->cost));
+
+        while (!stack.empty()) {
+            Operation *x = stack.back();
+            stack.pop_back();
+
+            if (x->cached || !visited.insert(x).second) {
+                continue;
+            }
+
+            if (transferred.count(x->digest()) == 0
+                && (op->predecessors.count(x) == 0
+                    || !x->transferable()
+                    || !x->store_to(transfer_path(x)))) {
+                stack.insert(stack.end(),
+                             x->predecessors.begin(), x->predecessors.end());
+
+                continue;
+            }
+
+            transferred.insert(x->digest());
+            append_field(
+                s, std::to_string(reinterpret_cast<std::uintptr_t>(x)));
+        }
+
+        if (!write_message(p.requests, s)) {
+            return false;
+        }
+
+        p.start = Trace_clock::now();
+        p.signalled = false;
+        p.operation = op;
+        p.report.clear();
+        p.sequence = begin_dispatch(unit_of(op), op, p.tag);
+
+        op->annotations.insert({"process", std::to_string(p.pid)});
+
+        return true;
+    }
+
+    // Conclude an operation evaluated in a child process, given its
+    // report, or once the process has exited, if it crashed.  If the
+    // result couldn't be transferred (but the operation didn't fail),
+    // evaluate it here instead.
+
+    void conclude_process(Process &p, const std::string *report)
+    {
+        Operation *op = p.operation;
+        Unit &u = unit_of(op);
+        bool failed = true;
+        const std::string s = transfer_path(op, p.pid);
+
+        if (!report) {
+            std::string m = "evaluation of % failed, as its process ";
+            int status;
+
+            while (waitpid(p.pid, &status, 0) < 0 && errno == EINTR);
+
+            if (WIFSIGNALED(status)) {
+                m += std::string("was terminated (")
+                    + strsignal(WTERMSIG(status)) + ")";
+            } else {
+                m += "exited unexpectedly";
+            }
+
+            op->message(Operation::ERROR, m);
+        } else if (const std::vector<std::string> v = parse_report(*report);
+                   v.size() >= 6) {
+            for (std::size_t i = 6; i + 1 < v.size(); i += 2) {
+                op->annotations.insert({v[i], v[i + 1]});
+            }
+
+            // Failures have already been reported by the child.
+
+            if (v[0] == "0" && v[1] != "0" && op->load_from(s)) {
+                Operation_costs c;
+
+                c.evaluation_time = std::stof(v[4]);
+                c.size = op->size();
+                c.memory = std::stoul(v[5]);
+                c.kind = op->kind();
+                record_operation_costs(op->digest(), c);
+
+                op->cost = std::stof(v[2]);
+                op->storable = (v[3] != "0");
+
+                failed = false;
+            } else if (v[0] == "0") {
+                failed = try_dispatch_operation(u, op);
+            }
+        }
+
+        // Keep the result around, in case it's needed as an operand
+        // of another delegated operation.
+
+        if (std::error_code e;
+            failed || !transferred.insert(op->digest()).second) {
+            std::filesystem::remove(s, e);
+        } else {
+            std::filesystem::rename(s, transfer_path(op), e);
+
+            if (e) {
+                transferred.erase(op->digest());
+            }
+        }
+
+        if (tracing()) {
+            trace_operation(u, op, 2001 + p.slot, p.start, Trace_clock::now());
+        }
+
+        p.operation = nullptr;
+
+        finish_dispatch(u, op, p.sequence, p.tag, failed);
+        conclude_operation();
+    }
+
+    inline bool processes_busy()
+    {
+        return std::any_of(processes.begin(), processes.end(),
+                           [](const Process &p) {
+                               return p.operation;
+                           });
+    }
+
+    // Collect the reports of busy processes, waiting for up to the
+    // given number of milliseconds (or indefinitely, if negative) for
+    // any of them to arrive and conclude the operations of those
+    // that have arrived in full.  Processes evaluating operations of
+    // cancelled units are signalled to abandon them.  Processes that
+    // have crashed are not replaced, as other threads may be running
+    // by now.
+
+    void collect_processes(int timeout)
+    {
+        if (!processes_busy()) {
+            return;
+        }
+
+        std::vector<pollfd> v;
+
+        for (Process &p: processes) {
+            if (!p.operation) {
+                continue;
+            }
+
+            if (!p.signalled && unit_of(p.operation).cancelled) {
+                kill(p.pid, SIGUSR1);
+                p.signalled = true;
+            }
+
+            v.push_back({p.reports, POLLIN, 0});
+        }
+
+        if (poll(v.data(), v.size(), timeout) <= 0) {
+            return;
+        }
+
+        auto it = processes.begin();
+
+        for (const pollfd &x: v) {
+            while (!it->operation) {
+                ++it;
+            }
+
+            Process &p = *it;
+
+            if (x.revents != 0) {
+                char b[4096];
+                const ssize_t n = read(p.reports, b, sizeof(b));
+
+                if (n > 0) {
+                    std::string m;
+
+                    p.report.append(b, n);
+
+                    if (extract_message(p.report, m)) {
+                        conclude_process(p, &m);
+                    }
+                } else if (n == 0 || errno != EINTR) {
+                    conclude_process(p, nullptr);
+                    close(p.requests);
+                    close(p.reports);
+                    it = processes.erase(it);
+
+                    continue;
+                }
+            }
+
+            ++it;
+        }
+    }
+
+    // Stop the processes, killing any still evaluating, e.g. after
+    // evaluation has halted, and clean up.  Idle processes exit once
+    // their request pipe is closed.
+
+    void stop_processes()
+    {
+        for (Process &p: processes) {
+            if (p.operation) {
+                kill(p.pid, SIGKILL);
+            }
+
+            close(p.requests);
+            close(p.reports);
+
+            while (waitpid(p.pid, nullptr, 0) < 0 && errno == EINTR);
+        }
+
+        if (!transfer_directory.empty()) {
+            std::error_code e;
+
+            std::filesystem::remove_all(transfer_directory, e);
+            transfer_directory.clear();
+            std::signal(SIGPIPE, sigpipe_handler);
+        }
+
+        processes.clear();
+        transferred.clear();
+    }
+#else
+    struct Process {};
+    std::list<Process> processes;
+
+    void start_processes() {}
+
+    bool delegate_operation(Operation *op)
+    {
+        return false;
+    }
+
+    bool processes_busy()
+    {
+        return false;
+    }
+
+    void collect_processes(int timeout) {}
+    void stop_processes() {}
+#endif
+
+    // Dispatch an operation in the main thread, or delegate it to a
+    // child process, if possible.
+
+    void dispatch_main_operation(Operation *op)
+    {
+        trace_waiting(-1);
+
+        if (!delegate_operation(op)) {
+            dispatch_operation(op);
+            conclude_operation();
+        }
+    }
+}
+
+void Worker::push(const Ready_entry &e)
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queue.push(e);
+}
+
+Operation *Worker::take()
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+
+    if (queue.empty()) {
+        return nullptr;
+    }
+
+    Operation *op = queue.top().operation;
+    queue.pop();
+
+    return op;
+}
+
+Operation *Worker::claim()
+{
+    while (!halted) {
+        Operation *op;
+
+        // Try the local queue first, then the global queue and
+        // finally try to steal from the other workers.
+
+        if (!(op = take()) && !(op = next_ready_operation(1))) {
+            const int n = workers.size();
+
+            for (int i = 1; i < n && !op; i++) {
+                op = workers[(index + i) % n].take();
+            }
+        }
+
+        if (op) {
+            available--;
+            return op;
+        }
+
+        // Nothing to do; sleep until more work becomes available.
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+
+        sleeping++;
+        idle_condition.wait(lock, [] { return draining || available > 0; });
+        sleeping--;
+
+        if (draining) {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+void Worker::work()
+{
+    current_worker = this;
+
+    trace_thread(1 + index, "worker " + std::to_string(index));
+
+    while (Operation *op = claim()) {
+        op->annotations.insert({"thread", std::to_string(index)});
+        trace_waiting(-1);
+
+        dispatch_operation(op);
+        conclude_operation();
+    }
+
+    current_worker = nullptr;
+}
+
+////////////////
+// Operations //
+////////////////
+
+#include "polygon_operations.h"
+#include "polyhedron_operations.h"
+#include "circle_polygon_types.h"
+#include "conic_polygon_types.h"
+#include "evaluation.h"
+
+// The unit operations are currently added to.
+
+static Unit *current;
+
+static Unit &current_unit()
+{
+    if (!current) {
+        current = &units.emplace_back(nullptr);
+    }
+
+    return *current;
+}
+
+// When sharing operations (or in watch mode), the results of
+// evaluated operations are retained across units, keyed by tag
+// digest.  Each entry records the unit that last used it, so that
+// the least recently used results can be evicted first.
+
+struct Cached_result {
+    std::shared_ptr<void> result;
+    const std::type_info *type;
+    std::size_t size;
+    unsigned long unit;
+};
+
+static std::unordered_map<std::string, Cached_result> cache;
+static std::size_t cache_size;
+static unsigned long unit_sequence;
+
+static inline bool retaining_results()
+{
+    return Flags::share_operations || Flags::watch;
+}
+
+std::unordered_map<std::string, std::shared_ptr<Operation>> &_get_operations()
+{
+    return current_unit().operations;
+}
+
+template<typename T>
+static bool try_fold(Operation *op)
+{
+    auto t = dynamic_cast<T *>(op);
+    return t && t->try_fold();
+}
+
+// Adopt the result of an identical operation, evaluated in a previous
+// unit, if it has been retained.  No loading or evaluation is then
+// necessary.
+
+static bool adopt_cached_result(Operation *op)
+{
+    if (!retaining_results()) {
+        return false;
+    }
+
+    auto it = cache.find(op->digest());
+
+    if (it == cache.end() || *it->second.type != typeid(*op)) {
+        return false;
+    }
+
+    op->set_result(it->second.result);
+    it->second.unit = unit_sequence;
+
+    return true;
+}
+
+// Retain the results of the evaluated units, then evict the least
+// recently used results that they didn't reference, until the cache
+// fits within its limit.
+
+static void retain_results()
+{
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            std::shared_ptr<void> p = x->get_result();
+
+            if (!x->selected || !p) {
+                continue;
+            }
+
+            Cached_result &c = cache[x->digest()];
+            const std::size_t n = x->size();
+
+            cache_size -= c.size;
+            cache_size += n;
+            c = {std::move(p), &typeid(*x), n, unit_sequence};
+        }
+    }
+
+    if (Options::cache_limit < 0) {
+        return;
+    }
+
+    const std::size_t limit =
+        static_cast<std::size_t>(Options::cache_limit) * 1048576;
+
+    if (cache_size <= limit) {
+        return;
+    }
+
+    std::vector<decltype(cache)::iterator> v;
+
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->second.unit < unit_sequence) {
+            v.push_back(it);
+        }
+    }
+
+    std::sort(v.begin(), v.end(), [](const auto &a, const auto &b) {
+        return a->second.unit < b->second.unit;
+    });
+
+    for (auto it: v) {
+        if (cache_size <= limit) {
+            break;
+        }
+
+        cache_size -= it->second.size;
+        cache.erase(it);
+    }
+}
+
+// Select a single operation, pushing the predecessors that remain
+// to be selected onto the stack.
+
+static void select_single_operation(
+    Operation *op, std::vector<Operation *> &stack)
+{
+    if (adopt_cached_result(op)) {
+        op->selected = op->cached = true;
+    } else {
+        op->select();
+    }
+
+    if (Flags::eliminate_dead_operations && (op->loadable || op->cached)) {
+        // Abridge the to-be-loaded (or cached) operation's tag here,
+        // as it won't happen during evaluation (since its
+        // predecessors will never be evaluated).
+
+        if (Flags::dump_abridged_tags) {
+            std::lock_guard<std::mutex> lock(dump_mutex);
+            std::string &r = unit_of(op).tags[op];
+
+            if (r.empty()) {
+                r = op->describe();
+            }
+
+            for (Operation *x: op->predecessors) {
+                const std::string k = x->describe();
+
+                for (size_t i = r.find(k);
+                     i != std::string::npos;
+                     i = r.find(k, i)) {
+                    r.replace(i, k.size(), "$");
+                };
+            }
+        }
+
+        // Modify the graph to turn the operation into a source
+        // operation, to be placed on the ready list.
+
+        for (Operation *x: op->predecessors) {
+            x->successors.erase(op);
+        }
+
+        op->predecessors.clear();
+    }
+
+    stack.insert(
+        stack.end(), op->predecessors.begin(), op->predecessors.end());
+}
+
+// Select an operation and, transitively, its predecessors.  The graph
+// is walked with an explicit stack, as chains of operations can be
+// arbitrarily long.
+
+static void select_operation(Operation *op)
+{
+    std::vector<Operation *> stack = {op};
+
+    while (!stack.empty()) {
+        op = stack.back();
+        stack.pop_back();
+
+        if (!op->selected) {
+            select_single_operation(op, stack);
+        }
+    }
+}
+
+// List the selected operations so that each follows all of its
+// selected successors, i.e. in reverse topological order.  The graph
+// is walked with an explicit stack, as chains of operations can be
+// arbitrarily long.
+
+static std::vector<Operation *> order_operations()
+{
+    std::unordered_map<Operation *, std::size_t> pending;
+    std::vector<Operation *> v, stack;
+
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            if (!x->selected) {
+                continue;
+            }
+
+            const std::size_t n = std::count_if(
+                x->successors.begin(), x->successors.end(),
+                [](const Operation *y) { return y->selected; });
+
+            pending[x.get()] = n;
+
+            if (n == 0) {
+                stack.push_back(x.get());
+            }
+        }
+    }
 
-static std::unordered_map<std::string, std::shared_ptr<Operation>> operations;
-static const char *unit_name;
+    v.reserve(pending.size());
 
-std::unordered_map<std::string, std::shared_ptr<Operation>> &_get_operations()
-{
-    return operations;
-}
+    while (!stack.empty()) {
+        Operation *op = stack.back();
+        stack.pop_back();
+        v.push_back(op);
 
-template<typename T>
-static bool try_fold(Operation *op)
-{
-    auto t = dynamic_cast<T *>(op);
-    return t && t->try_fold();
+        for (Operation *x: op->predecessors) {
+            if (auto it = pending.find(x);
+                it != pending.end() && --it->second == 0) {
+                stack.push_back(x);
+            }
+        }
+    }
+
+    return v;
 }
 
-static void select_operation(Operation *op)
-{
-    if (op->selected) {
-        return;
-    }
+// Estimate the time it will take to evaluate (or load) each operation
+// and all operations that depend on it (along the longest such chain)
+// and store it as the operation's priority.
 
-    op->select();
+static void prioritize_operations()
+{
+    std::unordered_map<Operation *, float> estimates;
+    float s = 0;
+    int n = 0;
 
-    if (Flags::eliminate_dead_operations && op->loadable) {
-        // Abridge the to-be-loaded operation's tag here, as it won't
-        // happen during evaluation (since its predecessors will
-        // never be evaluated).
+    // Look up the recorded costs of each operation.  Operations that
+    // haven't been evaluated (or loaded) before are assumed to take
+    // the mean recorded time.
 
-        if (Flags::dump_abridged_tags) {
-            std::lock_guard<std::mutex> lock(dump_mutex);
-            std::string &r = tags.insert({op, op->get_tag()}).first->second;
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            x->priority = -1;
 
-            for (Operation *x: op->predecessors) {
-                const std::string &k = x->get_tag();
+            if (!x->selected) {
+                continue;
+            }
 
-                for (size_t i = r.find(k);
-                     i != std::string::npos;
-                     i = r.find(k, i)) {
-                    r.replace(i, k.size(), "$");
-                };
+            if (x->cached) {
+                estimates[x.get()] = 0;
+                continue;
             }
-        }
 
-        // Modify the graph to turn the operation into a source
-        // operation, to be placed on the ready list.
+            const Operation_costs c = find_operation_costs(x->digest());
+            const float t = x->loadable ? c.load_time : c.evaluation_time;
 
-        for (Operation *x: op->predecessors) {
-            x->successors.erase(op);
+            estimates[x.get()] = t;
+
+            if (t >= 0) {
+                s += t;
+                n++;
+            }
         }
+    }
 
-        op->predecessors.clear();
+    for (auto &[x, t]: estimates) {
+        if (t < 0) {
+            t = (n > 0 ? s / n : 1);
+        }
     }
 
-    if (op->predecessors.empty()) {
-        ready_operation(op);
-    } else {
-        for (Operation *x: op->predecessors) {
-            select_operation(x);
+    // Operations are prioritized after their successors.
+
+    for (Operation *x: order_operations()) {
+        float t = 0;
+
+        for (Operation *y: x->successors) {
+            if (y->selected) {
+                t = std::max(t, y->priority);
+            }
         }
+
+        x->priority = t + estimates[x];
     }
 }
 
@@ -507,7 +2081,7 @@ static void rewrite_operations()
                      || n < Options::rewrite_pass_limit) ; n++) {
 
         bool p = false;
-        for (auto &[k, x]: operations) {
+        for (auto &[k, x]: current_unit().operations) {
             if ((Flags::fold_transformations
                  // Fold 2D transformations.
 
@@ -583,155 +2157,587 @@ static void rewrite_operations()
     }
 }
 
-void begin_unit(const char *name)
+// Evaluate the selected operations of all units, dispatching them to
+// the workers, the main thread and child processes, as they become
+// ready, and wait for any loads and stores to conclude.
+
+static void run_evaluation()
 {
-    operations.clear();
-    tags.clear();
+    // Fork the child processes first, as no other threads may be
+    // running at that point.
 
-    for (auto &r: ready) {
-        r.clear();
+    start_processes();
+
+    // Start the I/O threads, unless single-threaded operation has
+    // been requested, and start prefetching loadable sources.
+
+    if (worker_threads > 0
+        && (Flags::store_operations || Flags::load_operations)) {
+        io_draining = false;
+
+        for (int i = 0; i < Options::io_threads; i++) {
+            io_threads.emplace_back(work_io, i);
+        }
+    }
+
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            if (x->selected && x->pending == 0) {
+                prefetch_operation(x.get());
+            }
+        }
+    }
+
+    // Avoid spawning any threads if single-threaded operation is
+    // requested.
+
+    if (worker_threads == 0) {
+        assert(ready[1].empty());
+
+        while (!halted) {
+            collect_processes(0);
+
+            Operation *op = next_ready_operation(0);
+
+            if (op) {
+                dispatch_main_operation(op);
+            } else if (processes_busy()) {
+                collect_processes(-1);
+            } else {
+                break;
+            }
+        }
+    } else {
+        draining = false;
+
+        for (int i = 0; i < worker_threads; i++) {
+            workers.emplace_back(i);
+        }
+
+        for (Worker &w: workers) {
+            w.start();
+        }
+
+        // Dispatch thread-unsafe operations in the main thread, or
+        // in child processes, as they become ready, until all
+        // operations have concluded.  While processes are running,
+        // wake up periodically to collect them.
+
+        while (true) {
+            Operation *op = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(ready_mutex);
+                const auto p = [] {
+                    return !ready[0].empty() || outstanding == 0 || halted;
+                };
+
+                if (!processes_busy()) {
+                    ready_condition.wait(lock, p);
+                } else {
+                    ready_condition.wait_for(
+                        lock, std::chrono::milliseconds(10), p);
+                }
+
+                if (halted || (ready[0].empty() && outstanding == 0)) {
+                    break;
+                }
+
+                if (!ready[0].empty()) {
+                    op = ready[0].top().operation;
+                    ready[0].pop();
+                }
+            }
+
+            collect_processes(0);
+
+            if (op) {
+                dispatch_main_operation(op);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+
+            draining = true;
+            idle_condition.notify_all();
+        }
+
+        for (Worker &w: workers) {
+            w.join();
+        }
+
+        workers.clear();
+    }
+
+    stop_processes();
+
+    // Wait for any loads or stores still in progress.
+
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        io_draining = true;
+    }
+
+    io_condition.notify_all();
+
+    for (std::thread &t: io_threads) {
+        t.join();
+    }
+
+    io_threads.clear();
+}
+
+// Estimate the costs of evaluating the selected operations of all
+// units, based on the costs recorded in previous evaluations.
+// Operations without a record are assumed to cost the mean recorded
+// for operations of the same kind, or of any kind, if there are no
+// such records.  Evaluation is then simulated, dispatching ready
+// operations in order of priority to the workers, or to the main
+// thread and child processes, as the evaluator would, to predict
+// the wall time, as well as the peak memory occupied by results and
+// by evaluations in progress.
+
+static void estimate_evaluation()
+{
+    struct Estimated_costs {
+        double time;
+        std::size_t size, memory;
+    };
+
+    struct Model {
+        double time = 0, size = 0, memory = 0;
+        int n = 0;
+    };
+
+    std::unordered_map<std::string, Model> kinds;
+    Model all;
+
+    for_each_operation_costs(
+        [&kinds, &all](const std::string &, const Operation_costs &c) {
+            if (c.evaluation_time < 0) {
+                return;
+            }
+
+            for (Model *m: {&kinds[c.kind], &all}) {
+                m->time += c.evaluation_time;
+                m->size += c.size;
+                m->memory += c.memory;
+                m->n++;
+            }
+        });
+
+    std::unordered_map<Operation *, Estimated_costs> estimates;
+    int cached = 0, loaded = 0, recorded = 0, modelled = 0, unknown = 0;
+    double work = 0;
+
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            if (!x->selected) {
+                continue;
+            }
+
+            Estimated_costs &e = estimates[x.get()];
+
+            if (x->cached) {
+                e = {0, x->size(), 0};
+                cached++;
+                continue;
+            }
+
+            const Operation_costs c = find_operation_costs(x->digest());
+
+            loaded += x->loadable;
+
+            if (x->loadable && c.load_time >= 0) {
+                e = {c.load_time, c.size, c.size};
+                recorded++;
+            } else if (!x->loadable && c.evaluation_time >= 0) {
+                e = {c.evaluation_time, c.size, c.memory};
+                recorded++;
+            } else {
+                auto it = kinds.find(x->kind());
+                const Model &m = (it != kinds.end() ? it->second : all);
+
+                if (m.n > 0) {
+                    e = {m.time / m.n,
+                         static_cast<std::size_t>(m.size / m.n),
+                         static_cast<std::size_t>(m.memory / m.n)};
+                    modelled++;
+                } else {
+                    e = {0, 0, 0};
+                    unknown++;
+                }
+            }
+
+            work += e.time;
+        }
+    }
+
+    // Find the critical path, i.e. the chain of operations with the
+    // longest total estimated time.
+
+    std::unordered_map<Operation *, std::pair<double, Operation *>> paths;
+
+    Operation *first = nullptr;
+    double critical = 0;
+
+    for (Operation *x: order_operations()) {
+        std::pair<double, Operation *> p = {0, nullptr};
+
+        for (Operation *y: x->successors) {
+            if (y->selected && paths[y].first > p.first) {
+                p = {paths[y].first, y};
+            }
+        }
+
+        p.first += estimates[x].time;
+        paths[x] = p;
+
+        if (!first || p.first > critical) {
+            first = x;
+            critical = p.first;
+        }
+    }
+
+    // Simulate evaluation.  Thread-safe operations are evaluated by
+    // the workers, if there are any, while the rest are evaluated in
+    // the main thread or, if they qualify and there's a process to
+    // spare, delegated to child processes, as in run_evaluation().
+    // Operations are released once consumed, if disposable.
+
+    enum {MAIN, WORKER, PROCESS};
+    typedef std::pair<double, Operation *> Entry;
+
+    std::priority_queue<Entry> ready_queues[2];
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> events;
+    std::unordered_map<Operation *, int> pending, consumers, pools;
+    int slots[3] = {1, worker_threads, 0};
+    double t = 0;
+    std::size_t resident = 0, transient = 0, peak = 0;
+
+#ifndef _WIN32
+    slots[PROCESS] = Options::processes;
+#endif
+
+    auto queue_of = [](Operation *op) {
+        return worker_threads > 0 && is_threadsafe(op) ? WORKER : MAIN;
+    };
+
+    auto pool_of = [&slots](Operation *op, int i) -> int {
+        if (i == MAIN && slots[PROCESS] > 0 && qualifies_for_process(op)) {
+            return PROCESS;
+        }
+
+        return i;
+    };
+
+    for (auto &[x, e]: estimates) {
+        pending[x] = x->predecessors.size();
+        consumers[x] = x->consumers;
+
+        if (pending[x] == 0) {
+            ready_queues[queue_of(x)].push({paths[x].first, x});
+        }
+    }
+
+    while (true) {
+        for (int i: {MAIN, WORKER}) {
+            while (slots[i] > 0 && !ready_queues[i].empty()) {
+                Operation *op = ready_queues[i].top().second;
+                const Estimated_costs &e = estimates[op];
+                const int j = pool_of(op, i);
+
+                ready_queues[i].pop();
+                slots[j]--;
+                pools[op] = j;
+                events.push({t + e.time, op});
+                transient += e.memory > e.size ? e.memory - e.size : 0;
+            }
+        }
+
+        peak = std::max(peak, resident + transient);
+
+        if (events.empty()) {
+            break;
+        }
+
+        Operation *op = events.top().second;
+        const Estimated_costs &e = estimates[op];
+
+        t = events.top().first;
+        events.pop();
+
+        slots[pools[op]]++;
+        transient -= e.memory > e.size ? e.memory - e.size : 0;
+        resident += e.size;
+        peak = std::max(peak, resident + transient);
+
+        for (Operation *x: op->predecessors) {
+            if (x->disposable && --consumers[x] == 0) {
+                resident -= estimates[x].size;
+            }
+        }
+
+        for (Operation *x: op->successors) {
+            if (x->selected && --pending[x] == 0) {
+                ready_queues[queue_of(x)].push({paths[x].first, x});
+            }
+        }
+    }
+
+    // Report the estimates.
+
+    std::cout << std::setprecision(3)
+              << "Estimated evaluation of " << estimates.size()
+              << " operations (" << cached << " cached, "
+              << loaded << " to be loaded), using " << worker_threads
+              << " worker threads:\n"
+              << "  wall time:     " << t << "s (" << work << "s of work)\n"
+              << "  critical path: " << critical << "s\n"
+              << "  peak memory:   " << peak / 1048576.0 << "MB\n"
+              << "  costs:         " << recorded << " recorded, "
+              << modelled << " modelled per kind, "
+              << unknown << " unknown" << std::endl;
+
+    for (Operation *x = first; x; x = paths[x].second) {
+        std::ostringstream s;
+
+        s << "operation % is on the critical path, estimated at "
+          << std::setprecision(3) << estimates[x].time << "s";
+
+        x->message(Operation::NOTE, s.str());
     }
+}
+
+void begin_unit(const char *name)
+{
+    // Units are discarded once evaluated.  Units yet to be evaluated
+    // are kept, to be evaluated along with this one, only when
+    // combining units.
+
+    units.remove_if([](const Unit &u) {
+        return u.evaluated || !Flags::combine_units;
+    });
+
+    current = &units.emplace_back(name);
+    unit_sequence++;
+}
 
-    had_failure = false;
-    evaluation_sequence = 0;
-    unit_name = name;
+void discard_unit()
+{
+    units.remove_if([](const Unit &u) { return &u == current; });
+    current = nullptr;
 }
 
 void evaluate_unit()
 {
-    // Open any dump files.
+    // Reset the scheduler.
+
+    for (auto &r: ready) {
+        r = {};
+    }
+
+    ready_sequence = 0;
+    outstanding = 0;
+    available = 0;
+
+    resident.clear();
+    resident_size = peak_resident_size = total_size = 0;
+
+    cancelled_units = 0;
+    halted = false;
+    stores.clear();
+
+    // Open any dump files.  Each unit gets its own files, unless a
+    // specific file was requested, in which case it is shared.
 
 #define SET_UP_DUMP_STREAM(WHAT, EXT)                                   \
-    std::filebuf WHAT ##_dump_filebuf;                                  \
-                                                                        \
     if (Options::dump_## WHAT) {                                        \
         if (!std::strcmp(Options::dump_## WHAT, "-")) {                 \
-            WHAT ##_dump.rdbuf(std::cout.rdbuf());                      \
+            u.WHAT ##_dump.rdbuf(std::cout.rdbuf());                    \
         } else if (!std::strcmp(Options::dump_## WHAT, "")) {           \
-            WHAT ##_dump_filebuf.open(                                  \
-                std::string(unit_name ? unit_name : "a") + EXT,         \
-                std::ios::out);                                         \
-                                                                        \
-            WHAT ##_dump.rdbuf(&WHAT ##_dump_filebuf);                  \
-        } else {                                                        \
-            WHAT ##_dump_filebuf.open(                                  \
+            u.WHAT ##_filebuf.open(u.name + EXT, std::ios::out);        \
+            u.WHAT ##_dump.rdbuf(&u.WHAT ##_filebuf);                   \
+        } else if (&u == &units.front()) {                              \
+            u.WHAT ##_filebuf.open(                                     \
                 Options::dump_## WHAT, std::ios::out);                  \
-            WHAT ##_dump.rdbuf(&WHAT ##_dump_filebuf);                  \
+            u.WHAT ##_dump.rdbuf(&u.WHAT ##_filebuf);                   \
+        } else {                                                        \
+            u.WHAT ##_dump.rdbuf(units.front().WHAT ##_dump.rdbuf());   \
         }                                                               \
                                                                         \
-        WHAT ##_dump.precision(3);                                      \
+        u.WHAT ##_dump.precision(3);                                    \
     }
 
-    SET_UP_DUMP_STREAM(operations, ".list");
-    SET_UP_DUMP_STREAM(log, ".log");
-    SET_UP_DUMP_STREAM(graph, ".dot");
+    for (Unit &u: units) {
+        u.cancelled = false;
+
+        SET_UP_DUMP_STREAM(operations, ".list");
+        SET_UP_DUMP_STREAM(log, ".log");
+        SET_UP_DUMP_STREAM(graph, ".dot");
 
-    if (Options::dump_graph) {
-        graph_dump << "digraph {\n"
-                   << "node [shape=record]" << std::endl;
+        if (Options::dump_graph) {
+            u.graph_dump << "digraph {\n"
+                         << "node [shape=record]" << std::endl;
+        }
     }
 
 #undef SET_UP_DUMP_STREAM
 
-    // Rewrite and select operations.
+    // Open the trace.  Unlike the other dumps, it's shared among the
+    // units, as they share the threads of evaluation.
+
+    if (Options::dump_trace && !units.empty()) {
+        open_trace(*Options::dump_trace
+                   ? Options::dump_trace
+                   : (units.front().name + ".trace.json").c_str());
 
-    rewrite_operations();
+        trace_thread(0, "main");
 
-    for (auto &[k, x]: operations) {
-        if (Operation *p = x.get();
-            !Flags::eliminate_dead_operations
-            || dynamic_cast<Sink_operation *>(p)) {
-            select_operation(p);
+        for (int i = 0; i < Options::processes; i++) {
+            trace_track(2001 + i, "process " + std::to_string(i));
         }
     }
 
-    // Start the evaluation.
+    load_cost_database();
 
-    evaluation_start = std::chrono::steady_clock::now();
+    // The memory consumed by operations is only of use, when it's
+    // either recorded, or dumped.
 
-    // Avoid spawning any threads if single-threaded operation is
-    // requested.
+    if (Options::cost_database
+        || (Flags::dump_annotations
+            && (Options::dump_operations || Options::dump_graph))) {
+        enable_heap_accounting();
+    }
 
-    if (Options::threads == 0) {
-        assert(ready[1].empty());
-        while (!ready[0].empty() && (!had_failure || !Flags::warn_fatal_errors)) {
-            dispatch_operation(ready[0].back());
-            ready[0].pop_back();
-        }
-    } else {
-        std::list<Worker> workers;
+    // Rewrite the operations of each unit and note the unit each
+    // operation belongs to.
 
-        for (int i = 0; i < Options::threads; i++) {
-            workers.emplace_back(i);
+    for (Unit &u: units) {
+        Unit *p = current;
+
+        current = &u;
+        rewrite_operations();
+        current = p;
+
+        for (auto &[k, x]: u.operations) {
+            owners[x.get()] = &u;
         }
+    }
 
-        for (Worker &w: workers) {
-            w.start();
+    // Select operations.
+
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            if (Operation *p = x.get();
+                !Flags::eliminate_dead_operations
+                || dynamic_cast<Sink_operation *>(p)) {
+                select_operation(p);
+            }
         }
+    }
 
-        {
-            std::unique_lock<std::recursive_mutex> lock(ready_mutex);
+    // Prioritize the selected operations and place the source
+    // operations on the ready queues.
 
-            while (!had_failure || !Flags::warn_fatal_errors) {
-                int j = 0;
+    prioritize_operations();
 
-                // Allocate operations from the threadsafe ready queue
-                // and count workers left idle.
+    worker_threads = (Options::threads < 0
+                      ? automatic_threads() : Options::threads);
 
-                for (Worker &w: workers) {
-                    if (!ready[1].empty()) {
-                        if (w.evaluate(ready[1].back())) {
-                            ready[1].pop_back();
-                        }
-                    } else {
-                        j += w.evaluate(nullptr);
-                    }
-                }
+    for (Unit &u: units) {
+        for (auto &[k, x]: u.operations) {
+            if (!x->selected) {
+                continue;
+            }
 
-                assert(j == 0 || ready[1].empty());
+            x->pending = x->predecessors.size();
+            x->consumers = std::count_if(
+                x->successors.begin(), x->successors.end(),
+                [](Operation *y) { return y->selected; });
+
+            // Results that have been pinned, are needed by a sink, or
+            // aren't needed at all (and are therefore presumably
+            // final), are kept around after evaluation.  When results
+            // are retained across units, all of them are kept, so
+            // that --release-operations has no effect and memory is
+            // only bounded by the cache limit, once the unit has
+            // been evaluated.
+
+            x->disposable = (
+                Flags::release_operations
+                && !retaining_results()
+                && !x->pinned
+                && x->consumers > 0
+                && std::none_of(x->successors.begin(), x->successors.end(),
+                                [](Operation *y) {
+                                    return dynamic_cast<Sink_operation *>(y);
+                                }));
+        }
+    }
 
-                // Dispatch thread-unsafe operations in the main
-                // thread, when no thread-safe operations are
-                // available.
+    evaluation_start = std::chrono::steady_clock::now();
 
-                if (!ready[0].empty() && j > 0) {
-                    dispatch_operation(ready[0].back());
-                    ready[0].pop_back();
-                }
+    // When estimating, report the estimated costs of evaluation,
+    // instead of evaluating.
 
-                // If the ready queues are empty and all workers are
-                // idle, we're done, otherwise we're either stalled,
-                // or saturated and we need to wait for some more
-                // workers to finish.
+    if (Flags::estimate) {
+        estimate_evaluation();
+    } else {
+        run_evaluation();
+    }
 
-                const bool p = ready[1].empty() && ready[0].empty();
+    if (retaining_results()) {
+        retain_results();
+    }
 
-                if (p && j == Options::threads) {
-                    break;
-                }
+    // Finish and close the dumps.  Shared dumps are finished by the
+    // first unit.
 
-                if (p || j == 0) {
-                    ready_condition.wait(lock);
-                }
-            }
+    for (Unit &u: units) {
+        if (Options::dump_graph) {
+            u.graph_dump << "}" << std::endl;
         }
 
-        for (Worker &w: workers) {
-            w.stop();
+        if (Options::dump_log
+            && (&u == &units.front()
+                || u.log_dump.rdbuf() != units.front().log_dump.rdbuf())) {
+            u.log_dump << evaluation_timestamp()
+                       << ": peak result memory "
+                       << peak_resident_size / 1048576.0 << "MB ("
+                       << total_size / 1048576.0 << "MB without release)"
+                       << std::endl;
+
+            if (retaining_results()) {
+                u.log_dump << evaluation_timestamp()
+                           << ": retained " << cache.size() << " results ("
+                           << cache_size / 1048576.0 << "MB)" << std::endl;
+            }
         }
     }
 
-    if (Options::dump_graph) {
-        graph_dump << "}" << std::endl;
+    for (Unit &u: units) {
+        u.operations_dump.rdbuf(nullptr);
+        u.log_dump.rdbuf(nullptr);
+        u.graph_dump.rdbuf(nullptr);
+
+        u.operations_filebuf.close();
+        u.log_filebuf.close();
+        u.graph_filebuf.close();
+
+        u.evaluated = true;
     }
 
-    operations_dump.rdbuf(nullptr);
-    log_dump.rdbuf(nullptr);
-    graph_dump.rdbuf(nullptr);
+    owners.clear();
+
+    close_trace();
+    save_cost_database();
 }
 
 std::shared_ptr<Operation> find_operation(const std::string &k)
 {
+    auto &operations = current_unit().operations;
     auto p = operations.find(k);
 
     if (p != operations.end()) {
@@ -743,6 +2749,7 @@ std::shared_ptr<Operation> find_operation(const std::string &k)
 
 void rehash_operation(const std::string &k)
 {
+    auto &operations = current_unit().operations;
     auto n = operations.extract(k);
     assert(n);
     n.key() = n.mapped()->get_tag();
@@ -753,10 +2760,36 @@ void insert_operation(const std::shared_ptr<Operation> p)
 {
     // We should always insert at this point.
 
-    safely_assert(operations.insert({p->get_tag(), p}).second);
+    safely_assert(
+        current_unit().operations.insert({p->get_tag(), p}).second);
 }
 
 bool erase_operation(const Operation *p)
 {
-    return operations.erase(p->get_tag()) > 0;
+    return current_unit().operations.erase(p->get_tag()) > 0;
+}
+
+// The source files the operations of the current unit were
+// instantiated in, as annotated by the frontends.
+
+std::vector<std::string> unit_files()
+{
+    std::vector<std::string> v;
+
+    for (const auto &[k, x]: current_unit().operations) {
+        if (auto f = x->annotations.find("file");
+            f != x->annotations.end()) {
+            v.push_back(f->second);
+        }
+    }
+
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+
+    return v;
+}
+
+const std::shared_ptr<Arena> &current_arena()
+{
+    return current_unit().arena;
 }
@@ -18,29 +18,40 @@
 #ifndef EVALUATION_H
 #define EVALUATION_H
 
+#include <vector>
 #include "options.h"
+#include "arena.h"
 
 void begin_unit(const char *name);
+void discard_unit();
 void evaluate_unit();
 std::shared_ptr<Operation> find_operation(const std::string &k);
 void rehash_operation(const std::string &k);
 void insert_operation(const std::shared_ptr<Operation> p);
 bool erase_operation(const Operation *p);
+std::vector<std::string> unit_files();
+const std::shared_ptr<Arena> &current_arena();
 
 template<typename T, typename U = Operation, typename F, typename... Args>
 std::shared_ptr<U> add_operation(F &&first, Args &&... args)
 {
     std::shared_ptr<T> p;
+    std::shared_ptr<Arena> a;
+    Arena::Mark m = {};
 
     // We either accept a ready-made shared pointer to the operation,
-    // or the arguments needed to construct it.
+    // or the arguments needed to construct it, in which case it's
+    // allocated from the unit's arena.
 
     if constexpr (
         sizeof...(args) == 0
         && std::is_same_v<F, const std::shared_ptr<T> &>) {
         p = first;
     } else {
-        p = std::make_shared<T>(
+        a = current_arena();
+        m = a->mark();
+        p = std::allocate_shared<T>(
+            Arena_allocator<T>(a),
             std::forward<F>(first), std::forward<Args>(args)...);
     }
 
@@ -52,16 +63,32 @@ std::shared_ptr<U> add_operation(F &&first, Args &&... args)
 
     if (q) {
         if (Flags::warn_duplicate) {
+            if (Operation::hook) {
+                Operation::hook(*p);
+            }
+
             p->message(Operation::WARNING, "operation % already instantiated");
             q->message(Operation::NOTE, "first instance of operation");
         }
 
+        // Discard the duplicate and, if it was the last allocation
+        // made, reclaim its memory.
+
+        if (a && p.use_count() == 1) {
+            p.reset();
+            a->rewind(m);
+        }
+
         if constexpr (std::is_same_v<U, Operation>) {
             return q;
         } else {
             return std::dynamic_pointer_cast<U>(q);
         }
     } else {
+        if (Operation::hook) {
+            Operation::hook(*p);
+        }
+
         p->link();
         insert_operation(p);
 
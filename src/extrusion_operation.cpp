@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <sstream>
+
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
 #include <CGAL/Triangulation_vertex_base_with_info_2.h>
 #include <CGAL/Triangulation_face_base_with_info_2.h>
@@ -37,19 +39,39 @@ typedef CGAL::Constrained_Delaunay_triangulation_2<
 typedef Constrained_Delaunay_triangulation::Face_handle Face_handle;
 typedef Constrained_Delaunay_triangulation::Vertex_handle Vertex_handle;
 
-static void mark_domains(Constrained_Delaunay_triangulation& T,
-                         Face_handle face, int index)
+// Mark each face with the number of constraints crossed to reach it
+// from the infinite face.  The triangulation is traversed with an
+// explicit stack, as recursing once per face can exhaust the
+// (possibly smaller) stacks of worker threads for large polygons.
+
+static void mark_domains(Constrained_Delaunay_triangulation& T)
 {
-    int i;
+    std::vector<std::pair<Face_handle, int>> stack;
+
+    for(Face_handle f: T.all_face_handles()) {
+        f->info() = -1;
+    }
+
+    stack.emplace_back(T.infinite_face(), 0);
+
+    while (!stack.empty()) {
+        const auto [face, index] = stack.back();
+        stack.pop_back();
 
-    face->info() = index;
+        if (face->info() != -1) {
+            continue;
+        }
 
-    for (i = 0; i < 3; i++) {
-        Constrained_Delaunay_triangulation::Edge e(face, i);
-        Face_handle n = face->neighbor(i);
+        face->info() = index;
 
-        if (n->info() == -1) {
-            mark_domains(T, n, T.is_constrained(e) ? index + 1 : index);
+        for (int i = 0; i < 3; i++) {
+            Constrained_Delaunay_triangulation::Edge e(face, i);
+            Face_handle n = face->neighbor(i);
+
+            if (n->info() == -1) {
+                stack.emplace_back(
+                    n, T.is_constrained(e) ? index + 1 : index);
+            }
         }
     }
 }
@@ -72,11 +94,7 @@ inline static void extrude_polygon_with_holes(
         T.insert_constraint(H->vertices_begin(), H->vertices_end(), true);
     }
 
-    for(Face_handle f: T.all_face_handles()) {
-        f->info() = -1;
-    }
-
-    mark_domains(T, T.infinite_face(), 0);
+    mark_domains(T);
 
     // Extrude the triangulation.
 
@@ -87,9 +105,8 @@ inline static void extrude_polygon_with_holes(
     const std::size_t l = T.number_of_faces();
     const std::size_t m = T.constrained_edges().size();
     const std::size_t n = (steps - 1) * m;
-    std::vector<Vertex_handle> v;
+    std::vector<Vertex_handle> v(k);
 
-    v.reserve(k);
     points.reserve(points.size() + (steps - close) * k);
     polygons.reserve(polygons.size() + 2 * l + n);
 
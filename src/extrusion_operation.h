@@ -25,7 +25,7 @@
 
 class Extrusion_operation:
     public Unary_operation<Polygon_operation<Polygon_set>,
-                           Unsafe_polyhedron_operation<Polyhedron>> {
+                           Polyhedron_operation<Polyhedron>> {
 
     const std::vector<Aff_transformation_3> transformations;
 
@@ -16,6 +16,7 @@
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <forward_list>
+#include <sstream>
 
 #include "kernel.h"
 #include "macros.h"
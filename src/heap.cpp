@@ -0,0 +1,179 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <gmp.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define HEAP_BLOCK_SIZE(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define HEAP_BLOCK_SIZE(p) malloc_size(p)
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#define HEAP_BLOCK_SIZE(p) malloc_usable_size(p)
+#endif
+
+#include "heap.h"
+
+#ifdef HEAP_BLOCK_SIZE
+
+// The memory currently allocated by the thread, less the memory it
+// has freed, which can be negative, as it may free memory allocated
+// by other threads, and its peak since the current measurement
+// began.
+
+static thread_local std::ptrdiff_t allocated, peak;
+static std::atomic<bool> accounting;
+
+static void account_allocation(void *p)
+{
+    allocated += HEAP_BLOCK_SIZE(p);
+    peak = std::max(peak, allocated);
+}
+
+static void account_deallocation(void *p)
+{
+    allocated -= HEAP_BLOCK_SIZE(p);
+}
+
+static inline bool accounting_enabled()
+{
+    return accounting.load(std::memory_order_relaxed);
+}
+
+// All other variants of the global allocation and deallocation
+// functions are, by default, implemented in terms of these two,
+// except for the ones taking an alignment, which we leave
+// unaccounted.
+
+void *operator new(std::size_t n)
+{
+    void *p = std::malloc(n == 0 ? 1 : n);
+
+    if (!p) {
+        throw std::bad_alloc();
+    }
+
+    if (accounting_enabled()) {
+        account_allocation(p);
+    }
+
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p) {
+        if (accounting_enabled()) {
+            account_deallocation(p);
+        }
+
+        std::free(p);
+    }
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+// GMP memory is allocated via malloc as well, so that blocks
+// allocated before the functions below are installed, can be safely
+// freed through them.  They're only installed once accounting is
+// enabled, so they're always accounting.
+
+static void *allocate(std::size_t n)
+{
+    void *p = std::malloc(n);
+
+    if (!p) {
+        std::abort();
+    }
+
+    account_allocation(p);
+
+    return p;
+}
+
+static void *reallocate(void *p, std::size_t, std::size_t n)
+{
+    account_deallocation(p);
+    void *q = std::realloc(p, n);
+
+    if (!q) {
+        std::abort();
+    }
+
+    account_allocation(q);
+
+    return q;
+}
+
+static void deallocate(void *p, std::size_t)
+{
+    account_deallocation(p);
+    std::free(p);
+}
+
+void enable_heap_accounting()
+{
+    if (!accounting.exchange(true)) {
+        mp_set_memory_functions(allocate, reallocate, deallocate);
+    }
+}
+
+Heap_measurement begin_heap_measurement()
+{
+    const Heap_measurement m = {allocated, peak};
+
+    peak = allocated;
+
+    return m;
+}
+
+std::size_t end_heap_measurement(const Heap_measurement &m)
+{
+    const std::ptrdiff_t delta = peak - m.mark;
+
+    peak = std::max(peak, m.peak);
+
+    return static_cast<std::size_t>(std::max<std::ptrdiff_t>(delta, 0));
+}
+
+#else
+
+void enable_heap_accounting()
+{
+}
+
+Heap_measurement begin_heap_measurement()
+{
+    return {0, 0};
+}
+
+std::size_t end_heap_measurement(const Heap_measurement &)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,52 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <cstddef>
+
+// The heap memory allocated by each thread is accounted for, by
+// replacing the global allocation functions, as well as GMP's, so
+// that the memory consumed by an operation can be measured, while
+// other operations are evaluated concurrently.  Memory is accounted
+// to the thread that allocates it and the thread that frees it, so
+// that the measurements are approximate.  They're zero on platforms
+// where the size of allocated blocks can't be determined.
+
+// Accounting exacts a toll on each allocation, so it's off, and
+// measurements are zero, until enabled.  It's meant to be enabled
+// once, before evaluation, when the measurements are of use, and
+// can't be disabled afterwards.
+
+void enable_heap_accounting();
+
+// Start measuring the growth of the calling thread's heap memory.
+// Measurements can be nested.
+
+struct Heap_measurement {
+    std::ptrdiff_t mark, peak;
+};
+
+Heap_measurement begin_heap_measurement();
+
+// The peak growth of the calling thread's heap memory since the
+// measurement began, in bytes.  This concludes the measurement.
+
+std::size_t end_heap_measurement(const Heap_measurement &m);
+
+#endif
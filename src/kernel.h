@@ -18,6 +18,9 @@
 #ifndef KERNEL_H
 #define KERNEL_H
 
+#include <cstddef>
+#include <type_traits>
+
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 
 typedef CGAL::Exact_predicates_exact_constructions_kernel Kernel;
@@ -37,4 +40,66 @@ typedef Kernel::Vector_3 Vector_3;
 typedef Kernel::Plane_3 Plane_3;
 typedef Kernel::Sphere_3 Sphere_3;
 
+// An estimate of the memory occupied by the exact representation of
+// a number, or of the exact coordinates of a point or plane, in
+// bytes.  The lazy kernel only computes exact coordinates on demand,
+// so that they're only accounted for if they have been computed.
+// Exact numbers are typically GMP rationals, the numerator and
+// denominator of which are held in separately allocated arrays of
+// limbs.  Other exact number types (e.g. when CGAL is built without
+// GMPXX) are only accounted for by their footprint within the point
+// or plane.
+
+template<typename T>
+inline std::size_t exact_number_size([[maybe_unused]] const T &x)
+{
+#ifdef CGAL_USE_GMPXX
+    if constexpr (std::is_same_v<T, mpq_class>) {
+        return (mpq_numref(x.get_mpq_t())->_mp_alloc
+                + mpq_denref(x.get_mpq_t())->_mp_alloc) * sizeof(mp_limb_t);
+    }
+#endif
+
+    return 0;
+}
+
+inline std::size_t exact_size(const Point_2 &P)
+{
+    if (P.ptr()->is_lazy()) {
+        return 0;
+    }
+
+    const auto &E = P.exact();
+
+    return (sizeof(E)
+            + exact_number_size(E.x()) + exact_number_size(E.y()));
+}
+
+inline std::size_t exact_size(const Point_3 &P)
+{
+    if (P.ptr()->is_lazy()) {
+        return 0;
+    }
+
+    const auto &E = P.exact();
+
+    return (sizeof(E)
+            + exact_number_size(E.x())
+            + exact_number_size(E.y())
+            + exact_number_size(E.z()));
+}
+
+inline std::size_t exact_size(const Plane_3 &Pi)
+{
+    if (Pi.ptr()->is_lazy()) {
+        return 0;
+    }
+
+    const auto &E = Pi.exact();
+
+    return (sizeof(E)
+            + exact_number_size(E.a()) + exact_number_size(E.b())
+            + exact_number_size(E.c()) + exact_number_size(E.d()));
+}
+
 #endif
@@ -16,6 +16,7 @@
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <filesystem>
+#include <sstream>
 
 #include <lualib.h>
 #include <lauxlib.h>
@@ -104,7 +105,7 @@ static int tostring(lua_State *L)
 {
     const T &X = fromlua<T>(L, 1);
 
-    std::ostringstream s;
+    std::string s;
 
     if constexpr (std::is_same_v<T, Boxed_polygon>
                   || std::is_same_v<T, Boxed_polyhedron>) {
@@ -117,10 +118,9 @@ static int tostring(lua_State *L)
         compose_tag_helper<T>::compose(s, X);
     }
 
-    std::string t = s.str();
-    t.pop_back();
+    s.pop_back();
 
-    lua_pushstring(L, t.c_str());
+    lua_pushstring(L, s.c_str());
 
     return 1;
 }
@@ -819,6 +819,29 @@ static int output(lua_State *L)
     return 1;
 }
 
+// Pin the given polygons or polyhedra, so that their results are
+// retained after evaluation of the operations that consume them.
+// Returns its arguments.
+
+static int pin(lua_State *L)
+{
+    const int j = lua_gettop(L);
+
+    for (int i = 1; i <= j; i++) {
+        auto f = [](auto &&x) {
+            x->pinned = true;
+        };
+
+        if (luaL_testudata(L, i, "polygon")) {
+            std::visit(f, fromlua<Boxed_polygon>(L, i));
+        } else {
+            std::visit(f, fromlua<Boxed_polyhedron>(L, i));
+        }
+    }
+
+    return j;
+}
+
 static int offset(lua_State *L)
 {
     const FT delta = checkrational(L, 2);
@@ -1207,6 +1230,7 @@ static int open_base(lua_State *L)
         {"print_warning", print<Operation::WARNING>},
         {"print_error", print<Operation::ERROR>},
         {"output", output},
+        {"pin", pin},
 
         {nullptr, nullptr}};
 
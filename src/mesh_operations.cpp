@@ -22,6 +22,7 @@
 
 #include "kernel.h"
 #include "iterators.h"
+#include "cancellation.h"
 #include "selection.h"
 #include "polyhedron_operations.h"
 #include "mesh_operations.h"
@@ -33,7 +34,7 @@ void Color_selection_operation<T>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Surface_mesh>(*operand->get_value());
+    polyhedron = operand->take_value();
 
     using U = std::conditional_t<std::is_same_v<T, Face_selector>,
                                  Surface_mesh::Face_index,
@@ -76,7 +77,7 @@ void Perturb_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
     if (magnitude <= 0) {
         return;
@@ -111,7 +112,7 @@ void Refine_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
 
     CGAL::Polygon_mesh_processing::triangulate_faces(
@@ -152,7 +153,7 @@ void Remesh_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
     std::unordered_set<
         typename boost::graph_traits<T>::edge_descriptor> constrained;
@@ -162,7 +163,11 @@ void Remesh_operation<T>::evaluate()
         constrained.insert(v.cbegin(), v.cend());
     }
 
-    const auto is_constrained = CGAL::Boolean_property_map(constrained);
+    // The map of constrained edges is consulted throughout remeshing,
+    // so we also use it to check for cancellation.
+
+    const auto is_constrained = Cancelling_property_map(
+        CGAL::Boolean_property_map(constrained));
 
     // Isotropic remeshing accepts a polygonal mesh, but the selected
     // faces, must be triangulated.
@@ -173,38 +178,23 @@ void Remesh_operation<T>::evaluate()
 
         const auto &v = face_selector->apply(*this->polyhedron);
 
-        if (edge_selector) {
-            CGAL::Polygon_mesh_processing::isotropic_remeshing(
-                v, CGAL::to_double(this->target), *this->polyhedron,
-                CGAL::Polygon_mesh_processing::parameters::edge_is_constrained_map(
-                    is_constrained).number_of_iterations(
-                    iterations));
-        } else {
-            CGAL::Polygon_mesh_processing::isotropic_remeshing(
-                v, CGAL::to_double(this->target), *this->polyhedron,
-                CGAL::Polygon_mesh_processing::parameters::number_of_iterations(
+        CGAL::Polygon_mesh_processing::isotropic_remeshing(
+            v, CGAL::to_double(this->target), *this->polyhedron,
+            CGAL::Polygon_mesh_processing::parameters::edge_is_constrained_map(
+                is_constrained).number_of_iterations(
                     iterations));
-        }
 
         this->annotations.insert({"selected", std::to_string(v.size())});
     } else {
         CGAL::Polygon_mesh_processing::triangulate_faces(
             CGAL::faces(*this->polyhedron), *this->polyhedron);
 
-        if (edge_selector) {
-            CGAL::Polygon_mesh_processing::isotropic_remeshing(
-                CGAL::faces(*this->polyhedron),
-                CGAL::to_double(this->target), *this->polyhedron,
-                CGAL::Polygon_mesh_processing::parameters::edge_is_constrained_map(
-                    is_constrained).number_of_iterations(
-                        iterations));
-        } else {
-            CGAL::Polygon_mesh_processing::isotropic_remeshing(
-                CGAL::faces(*this->polyhedron),
-                CGAL::to_double(this->target), *this->polyhedron,
-                CGAL::Polygon_mesh_processing::parameters::number_of_iterations(
-                        iterations));
-        }
+        CGAL::Polygon_mesh_processing::isotropic_remeshing(
+            CGAL::faces(*this->polyhedron),
+            CGAL::to_double(this->target), *this->polyhedron,
+            CGAL::Polygon_mesh_processing::parameters::edge_is_constrained_map(
+                is_constrained).number_of_iterations(
+                    iterations));
     }
 }
 
@@ -218,14 +208,17 @@ void Corefine_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->first->get_value());
     T B(*this->second->get_value());
+    this->polyhedron = this->first->take_value();
 
     CGAL::Polygon_mesh_processing::triangulate_faces(
         CGAL::faces(*this->polyhedron), *this->polyhedron);
     CGAL::Polygon_mesh_processing::triangulate_faces(CGAL::faces(B), B);
 
-    CGAL::Polygon_mesh_processing::corefine(*this->polyhedron, B);
+    CGAL::Polygon_mesh_processing::corefine(
+        *this->polyhedron, B,
+        CGAL::Polygon_mesh_processing::parameters::visitor(
+            Cancelling_corefinement_visitor<T>()));
 }
 
 template void Corefine_operation<Polyhedron>::evaluate();
@@ -240,7 +233,7 @@ void Corefine_with_plane_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
     CGAL::Bbox_3 b = CGAL::Polygon_mesh_processing::bbox(*this->polyhedron);
     b.dilate(1);
 
@@ -275,7 +268,10 @@ void Corefine_with_plane_operation<T>::evaluate()
     CGAL::Polygon_mesh_processing::triangulate_faces(
         CGAL::faces(*this->polyhedron), *this->polyhedron);
 
-    CGAL::Polygon_mesh_processing::corefine(*this->polyhedron, B);
+    CGAL::Polygon_mesh_processing::corefine(
+        *this->polyhedron, B,
+        CGAL::Polygon_mesh_processing::parameters::visitor(
+            Cancelling_corefinement_visitor<T>()));
 }
 
 template void Corefine_with_plane_operation<Polyhedron>::evaluate();
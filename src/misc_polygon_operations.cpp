@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <sstream>
+
 #include "assertions.h"
 #include "compressed_stream.h"
 #include "options.h"
@@ -83,14 +85,12 @@ static void store_polygon(std::ostream &s, const T &P)
 template<typename T>
 bool Polygon_operation<T>::store()
 {
-    // Conics aren't supported.  Storing point coordinates exactly is
-    // not very straightforward.
+    // Conics aren't supported.
 
-    if constexpr (std::is_same_v<T, Conic_polygon>) {
+    if constexpr (!is_storable_polygon_set<T>::value) {
         return Operation::store();
     }
 
-    assert(Flags::store_operations);
     assert(polygon);
 
     const T &S = *polygon;
@@ -256,11 +256,10 @@ static void load_polygon(std::istream &s, T &P)
 template<typename T>
 bool Polygon_operation<T>::load()
 {
-    if constexpr (std::is_same_v<T, Conic_polygon>) {
+    if constexpr (!is_storable_polygon_set<T>::value) {
         return Operation::load();
     }
 
-    assert(Flags::load_operations);
     assert(!polygon);
 
     compressed_ifstream_wrapper f(Options::store_compression >= 0);
@@ -331,7 +330,7 @@ void Polygon_complement_operation<T>::evaluate()
 {
     assert(!this->polygon);
 
-    this->polygon = std::make_shared<T>(*this->operand->get_value());
+    this->polygon = this->operand->take_value();
     this->polygon->complement();
 }
 
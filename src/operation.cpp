@@ -17,141 +17,78 @@
 
 #include <cstdint>
 #include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <mutex>
+#include <utility>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include <CGAL/exceptions.h>
 
 #include "options.h"
 #include "operation.h"
+#include "cost_database.h"
+#include "counters.h"
+#include "digest.h"
+#include "heap.h"
+#include "trace.h"
 
 std::function<void(Operation &)> Operation::hook;
+thread_local const std::atomic<bool> *Operation::cancellation;
+thread_local bool Operation::describing_structure;
 
-static std::uint32_t rotl32 (std::uint32_t x, unsigned int n) {
-    return (x << n) | (x >> (32 - n));
-}
-
-static std::string sha1digest(const std::string &message)
+static inline float seconds_since(
+    const std::chrono::steady_clock::time_point &t_0)
 {
-    const std::uint8_t *s =
-        reinterpret_cast<const std::uint8_t *>(message.c_str());
-    const int n = message.size();
-
-    std::uint8_t buffer[64];
-
-    std::uint32_t h_0 = 0x67452301;
-    std::uint32_t h_1 = 0xefcdab89;
-    std::uint32_t h_2 = 0x98badcfe;
-    std::uint32_t h_3 = 0x10325476;
-    std::uint32_t h_4 = 0xc3d2e1f0;
-
-    for (int j = 0; j < ((n + 9 + 63) / 64) * 64; j += 64) {
-        const std::uint8_t *p;
-
-        if (n - j >= 64) {
-            // Not the last block; do not pad.
-
-            p = s + j;
-        } else {
-            int i = 0;
-
-            p = buffer;
-
-            // Copy rest of message and add the terminating 1 bit.
-
-            if (j <= n) {
-                memcpy(buffer, s + j, (i = n - j));
-                buffer[i++] = 0x80;
-            }
-
-            // Pad as needed with zeros and append the message length
-            // as 64bit big-endian if it fits (otherwise another block
-            // must be added).
-
-            if (i <= 56) {
-
-                memset(buffer + i, 0, 56 - i);
-                for (auto [k, m] = std::pair<int, std::uint64_t>(63, n * 8);
-                     k >= 56;
-                     k--, m >>= 8) {
-                    buffer[k] = m & 0xff;
-                }
-            } else {
-                memset(buffer + i, 0, 64 - i);
-            }
-        }
-
-        // Process the block.
+    return std::chrono::duration_cast<std::chrono::duration<float>>(
+        std::chrono::steady_clock::now() - t_0).count();
+}
 
-        std::uint32_t w[80];
+// Format a size in bytes for annotations.
 
-        for (int i = 0; i < 16 ; i++) {
-            const std::uint8_t *q = p + i * 4;
-            w[i] = q[3] | (q[2] << 8) | (q[1] << 16) | (q[0] << 24);
-        }
+static std::string format_size(const std::size_t n)
+{
+    static const char *units[] = {"B", "kB", "MB", "GB", "TB"};
+    double x = n;
+    int i = 0;
 
-        for (int i = 16; i < 80 ; i++) {
-            w[i] = rotl32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
-        }
+    for (; x >= 1024 && i < 4; x /= 1024, i += 1);
 
-        std::uint32_t a = h_0;
-        std::uint32_t b = h_1;
-        std::uint32_t c = h_2;
-        std::uint32_t d = h_3;
-        std::uint32_t e = h_4;
-
-        for (int i = 0; i < 80 ; i++) {
-            std::uint32_t f, k;
-
-            if (i < 20) {
-                f = (b & c) | ((~ b) & d);
-                k = 0x5a827999;
-            } else if (i < 40) {
-                f = b ^ c ^ d;
-                k = 0x6ed9eba1;
-            } else if (i < 60) {
-                f = (b & c) | (b & d) | (c & d);
-                k = 0x8f1bbcdc;
-            } else {
-                f = b ^ c ^ d;
-                k = 0xca62c1d6;
-            }
+    std::ostringstream s;
+    s.precision(3);
+    s << x << units[i];
 
-            std::uint32_t g = rotl32(a, 5) + f + e + k + w[i];
+    return s.str();
+}
 
-            e = d;
-            d = c;
-            c = rotl32(b, 30);
-            b = a;
-            a = g;
-        }
+// Messages are output under a lock, which mustn't be left locked in
+// child processes forked while another thread was holding it.
 
-        h_0 = h_0 + a;
-        h_1 = h_1 + b;
-        h_2 = h_2 + c;
-        h_3 = h_3 + d;
-        h_4 = h_4 + e;
-    }
+static std::mutex message_mutex;
 
-    // Output the digest in hex form.
-
-    std::ostringstream h;
-    h << std::hex << h_0 << h_1 << h_2 << h_3 << h_4;
-    return h.str();
-}
+#ifndef _WIN32
+static const int message_atfork = pthread_atfork(
+    [] { message_mutex.lock(); },
+    [] { message_mutex.unlock(); },
+    [] { message_mutex.unlock(); });
+#endif
 
 void Operation::message(Message_level level, std::string message)
 {
     std::string tag;
 
     if (Options::diagnostics_elide_tags < 0) {
-        tag = get_tag();
+        tag = describe();
     } else {
         std::ostringstream s;
 
         int i = 0;
-        for (const char d: get_tag()) {
+        for (const char d: describe()) {
             if (d == ')') {
                 i -= 1;
             }
@@ -178,26 +115,28 @@ void Operation::message(Message_level level, std::string message)
         tag += "...";
     }
 
+    std::ostringstream s;
+
     // Output the file and line number, if available.
 
     for (int i = 0; i < 2; i++) {
         if (auto f = annotations.find("file"); f != annotations.end()) {
             switch (level) {
-            case NOTE: std::cerr << ANSI_COLOR(1, 32); break;
-            case WARNING: std::cerr << ANSI_COLOR(1, 33); break;
-            case ERROR: std::cerr << ANSI_COLOR(1, 31); break;
+            case NOTE: s << ANSI_COLOR(1, 32); break;
+            case WARNING: s << ANSI_COLOR(1, 33); break;
+            case ERROR: s << ANSI_COLOR(1, 31); break;
             }
 
-            std::cerr << f->second << ANSI_COLOR(0, 37) << ":";
+            s << f->second << ANSI_COLOR(0, 37) << ":";
         }
 
         if (auto l = annotations.find("line"); l != annotations.end()) {
-            std::cerr << ANSI_COLOR(1, 37) << l->second << ANSI_COLOR(0, 37)
-                      << ": ";
+            s << ANSI_COLOR(1, 37) << l->second << ANSI_COLOR(0, 37)
+              << ": ";
         }
 
         if (i == 0) {
-            std::cerr << "in operation '" << tag << "'\n";
+            s << "in operation '" << tag << "'\n";
         }
     }
 
@@ -205,14 +144,14 @@ void Operation::message(Message_level level, std::string message)
 
     switch (level) {
     case NOTE:
-        std::cerr << ANSI_COLOR(1, 32) << "note" << ANSI_COLOR(0, 37) << ": ";
+        s << ANSI_COLOR(1, 32) << "note" << ANSI_COLOR(0, 37) << ": ";
         break;
     case WARNING:
-        std::cerr << ANSI_COLOR(1, 33) << "warning"
-                  << ANSI_COLOR(0, 37) << ": ";
+        s << ANSI_COLOR(1, 33) << "warning"
+          << ANSI_COLOR(0, 37) << ": ";
         break;
     case ERROR:
-        std::cerr << ANSI_COLOR(1, 31) << "error" << ANSI_COLOR(0, 37) << ": ";
+        s << ANSI_COLOR(1, 31) << "error" << ANSI_COLOR(0, 37) << ": ";
         break;
     }
 
@@ -220,35 +159,100 @@ void Operation::message(Message_level level, std::string message)
 
     for (auto c = message.cbegin(); c != message.cend(); c++) {
         if (*c != '%') {
-            std::cerr.put(*c);
+            s.put(*c);
         } else if (c + 1 != message.cend() && *(c + 1) == '%') {
-            std::cerr.put(*c++);
+            s.put(*c++);
         } else {
-            std::cerr << '\'' << ANSI_COLOR(1, 37) << tag
-                      << ANSI_COLOR(0, 37) << '\'';
+            s << '\'' << ANSI_COLOR(1, 37) << tag
+              << ANSI_COLOR(0, 37) << '\'';
         }
     }
 
-    std::cerr << std::endl;
+    s << std::endl;
+
+    // Output the complete message at once, so that messages from
+    // operations evaluated in parallel aren't interleaved.
+
+    {
+        std::lock_guard<std::mutex> lock(message_mutex);
+
+        std::cerr << s.str() << std::flush;
+    }
 
     if (Flags::warn_error && level == WARNING) {
         throw operation_warning_error("previous warning treated as error");
     }
 }
 
-std::string Operation::digest()
+std::string Operation::describe_structure() const
+{
+    const bool b = describing_structure;
+
+    describing_structure = true;
+    const std::string s = describe();
+    describing_structure = b;
+
+    return s;
+}
+
+const std::string &Operation::reset_tag()
+{
+    return (tag = sha1digest(describe_structure()));
+}
+
+// Stores written before operations were tagged by a digest of their
+// structure hold results under the (legacy) digest of their full
+// description.  When asked to migrate such a store, its entries are
+// listed once, and each is renamed to its current name when the
+// operation it belongs to is selected, so that it remains loadable.
+// Entries that belong to no operation are left as they are.
+
+static std::once_flag legacy_flag;
+static std::mutex legacy_mutex;
+static std::unordered_set<std::string> legacy_entries;
+
+static void list_legacy_entries()
+{
+    std::error_code e;
+
+    for (const auto &x: std::filesystem::directory_iterator(
+             store_file_path("."), e)) {
+        const std::filesystem::path &p = x.path();
+
+        if (x.is_regular_file(e)
+            && (p.extension() == ".o" || p.extension() == ".zo")) {
+            legacy_entries.insert(p.filename().string());
+        }
+    }
+}
+
+static bool adopt_legacy_entry(const Operation *op, const std::string &path)
 {
-    if (tag_digest.empty()) {
-        tag_digest = sha1digest(get_tag());
+    std::lock_guard<std::mutex> lock(legacy_mutex);
+
+    if (legacy_entries.empty()) {
+        return false;
     }
 
-    return tag_digest;
+    const std::string s =
+        legacy_sha1digest(op->describe())
+        + std::filesystem::path(path).extension().string();
+
+    if (legacy_entries.erase(s) == 0) {
+        return false;
+    }
+
+    std::error_code e;
+    std::filesystem::rename(store_file_path(s), path, e);
+
+    return !e;
 }
 
 void Operation::select()
 {
     selected = true;
-    store_path = digest() + (Options::store_compression < 0 ? ".o" : ".zo");
+    store_path = store_file_path(
+        digest() + (Options::store_compression < 0 ? ".o" : ".zo"));
 
     if (!Flags::load_operations) {
         return;
@@ -257,6 +261,11 @@ void Operation::select()
     std::ifstream f(store_path);
     loadable = f && f.is_open();
 
+    if (!loadable && Flags::migrate_store) {
+        std::call_once(legacy_flag, list_legacy_entries);
+        loadable = adopt_legacy_entry(this, store_path);
+    }
+
     return;
 }
 
@@ -266,11 +275,32 @@ bool Operation::dispatch()
         return false;
     }
 
+    // The result may have been retained from a previous unit.
+
+    if (cached) {
+        annotations.insert({"cached", "true"});
+        return false;
+    }
+
     // Try loading if previously stored.
 
     if (loadable) {
-        if (load()) {
-            annotations.insert({"loaded", store_path});
+        auto t_0 = std::chrono::steady_clock::now();
+        const bool p = load();
+
+        if (tracing()) {
+            trace_span("load", "load", t_0, Trace_clock::now());
+        }
+
+        if (p) {
+            Operation_costs c;
+
+            c.load_time = seconds_since(t_0);
+            record_operation_costs(digest(), c);
+
+            annotations.insert({
+                    {"loaded", store_path},
+                    {"size", format_size(size())}});
 
             if (Flags::warn_load) {
                 message(WARNING, "Operation % was loaded");
@@ -284,10 +314,44 @@ bool Operation::dispatch()
 
     // Evaluate.
 
+    check_cancellation();
+
+    Event_measurement e{};
+
+    if (Flags::count_events) {
+        e = begin_event_measurement();
+    }
+
+    const Heap_measurement m = begin_heap_measurement();
     auto t_0 = std::chrono::steady_clock::now();
     evaluate();
-    float delta = std::chrono::duration_cast<std::chrono::duration<float>>(
-        std::chrono::steady_clock::now() - t_0).count();
+    float delta = seconds_since(t_0);
+    const std::size_t memory = end_heap_measurement(m);
+
+    if (Flags::count_events) {
+        for (const auto &[k, n]: end_event_measurement(e)) {
+            annotations.insert({k, std::to_string(n)});
+        }
+    }
+
+    if (tracing()) {
+        trace_span("evaluate", "evaluate", t_0, Trace_clock::now());
+    }
+
+    {
+        Operation_costs c;
+
+        c.evaluation_time = delta;
+        c.size = size();
+        c.memory = memory;
+        c.kind = kind();
+
+        record_operation_costs(digest(), c);
+
+        annotations.insert({
+                {"size", format_size(c.size)},
+                {"memory", format_size(c.memory)}});
+    }
 
     {
         std::ostringstream s;
@@ -307,16 +371,58 @@ bool Operation::dispatch()
         annotations.insert({"cost", s.str()});
     }
 
-    if (Flags::store_operations
-        && cost > Options::store_threshold) {
-        if (store()) {
-            annotations.insert({"stored", store_path});
+    // Don't store operations that are known to take longer to load,
+    // than to evaluate (along with their predecessors).  Storing
+    // itself is left to the evaluator, which can choose to do it in
+    // the background.
 
-            if (Flags::warn_store) {
-                message(WARNING, "Operation % was stored");
-            }
-        }
-    }
+    storable = (Flags::store_operations
+                && cost > Options::store_threshold
+                && find_operation_costs(digest()).load_time < cost);
 
     return false;
 }
+
+// Store the operation's result, returning whether it was stored.  The
+// evaluator annotates the operation, as it may be storing it in the
+// background.
+
+bool Operation::try_store()
+{
+    if (Options::store_directory) {
+        std::error_code e;
+        std::filesystem::create_directories(Options::store_directory, e);
+    }
+
+    if (!store()) {
+        return false;
+    }
+
+    if (Flags::warn_store) {
+        message(WARNING, "Operation % was stored");
+    }
+
+    return true;
+}
+
+// Store or load the result to or from a path other than the store.
+
+bool Operation::store_to(const std::string &path)
+{
+    const std::string s = std::exchange(store_path, path);
+    const bool p = store();
+
+    store_path = s;
+
+    return p;
+}
+
+bool Operation::load_from(const std::string &path)
+{
+    const std::string s = std::exchange(store_path, path);
+    const bool p = load();
+
+    store_path = s;
+
+    return p;
+}
@@ -19,33 +19,58 @@
 #define OPERATION_H
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
 
 #include "assertions.h"
 #include "compose_tag.h"
+#include "small_set.h"
 
 class operation_warning_error: public std::runtime_error {
 public:
     using std::runtime_error::runtime_error;
 };
 
+// Thrown from within an evaluating operation, when evaluation has
+// been cancelled.
+
+class operation_cancelled: public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
 // An operation is a wrapper around a process that creates, modifies
-// or consumes geometry.  It has a tag, which must be unique (and is
-// typically a textual representation of the operation) and it can be
-// evaluated to yield a result, typically some geometry.
+// or consumes geometry.  It has a textual description and a tag,
+// which must be unique, and it can be evaluated to yield a result,
+// typically some geometry.
 
 class Operation {
 protected:
-    std::string tag, tag_digest, store_path;
+    std::string tag, store_path;
 
 public:
+    // Called on each operation added to the graph, e.g. so that
+    // frontends can annotate it with its location in the source.
+
     static std::function<void(Operation &)> hook;
-    std::unordered_set<Operation *> predecessors, successors;
+    static thread_local const std::atomic<bool> *cancellation;
+
+    // Set while describing the structure of an operation, in which
+    // case operands are described by their tag, instead of their full
+    // description.
+
+    static thread_local bool describing_structure;
+    Small_set<Operation *> predecessors, successors;
     std::unordered_map<std::string, std::string> annotations;
-    bool selected, loadable;
-    float cost;
+    bool selected, loadable, pinned;
+    bool disposable;            // Result can be dropped once consumed.
+    bool storable;              // Result should be stored once evaluated.
+    bool cached;                // Result retained from a previous unit.
+    float cost, priority;
+    std::atomic<int> pending;   // Predecessors pending evaluation.
+    std::atomic<int> consumers; // Successors pending evaluation.
 
     enum Message_level {
         NOTE,
@@ -55,13 +80,27 @@ public:
 
     void message(Message_level level, std::string message);
 
-public:
-    Operation(): selected(false), loadable(false), cost(0.0) {
-        if (hook) {
-            hook(*this);
+    // Long-running operations should call this periodically during
+    // evaluation, so that they can be abandoned promptly, once
+    // evaluation has been cancelled (e.g. due to a fatal error
+    // elsewhere).  The evaluator points the cancellation flag to
+    // that of the unit under evaluation in the current thread.  Some
+    // algorithms, notably the Nef polyhedron booleans and
+    // constructions, offer no hooks, so they can only be checked
+    // before and after; once started, they run to completion.
+
+    static void check_cancellation() {
+        if (cancellation
+            && cancellation->load(std::memory_order_relaxed)) {
+            throw operation_cancelled("evaluation cancelled");
         }
     }
 
+public:
+    Operation(): selected(false), loadable(false), pinned(false),
+                 disposable(false), storable(false), cached(false), cost(0.0),
+                 priority(0.0), pending(0), consumers(0) {}
+
     Operation(const Operation &) = delete;
     Operation &operator=(const Operation &) = delete;
 
@@ -94,16 +133,69 @@ public:
         return false;
     }
 
-    const std::string &reset_tag() {
-        return (tag = describe());
+    bool try_store();
+
+    const std::string &get_store_path() const {
+        return store_path;
+    }
+
+    // Whether the result can be stored, so that it can also be
+    // transferred across processes, by storing it to, and loading it
+    // from, a given path, instead of the store.
+
+    virtual bool transferable() const {
+        return false;
+    }
+
+    bool store_to(const std::string &path);
+    bool load_from(const std::string &path);
+
+    // An estimate of the memory occupied by the operation's result,
+    // in bytes.
+
+    virtual std::size_t size() const {
+        return 0;
+    }
+
+    // Drop the operation's result, once it's no longer needed.
+
+    virtual void release() {}
+
+    // Get the result as an opaque pointer, or adopt the result of an
+    // identical operation (e.g. one retained from a previous unit).
+
+    virtual std::shared_ptr<void> get_result() const {
+        return nullptr;
     }
 
+    virtual void set_result(const std::shared_ptr<void> &p) {}
+
+    // The tag is a fixed-size digest of the operation's structure,
+    // i.e. of its name, its parameters and the tags of its operands.
+    // As such, it doesn't grow with the depth of the graph.  The full
+    // description, which does, is only built on demand, via
+    // describe().
+
+    std::string describe_structure() const;
+
+    const std::string &reset_tag();
+
     const std::string &get_tag() const{
         assert(!tag.empty());
         return tag;
     }
 
-    std::string digest();
+    // The kind of the operation, i.e. the name heading its
+    // description, such as "join".
+
+    std::string kind() const {
+        const std::string s = describe_structure();
+        return s.substr(0, s.find('('));
+    }
+
+    const std::string &digest() const {
+        return get_tag();
+    }
 };
 
 // Tag composition
@@ -112,10 +204,21 @@ template<typename T>
 struct compose_tag_helper<std::shared_ptr<T>,
                           std::enable_if_t<
                               std::is_base_of_v<Operation, T>>> {
-    static void compose(std::ostringstream &s, const std::shared_ptr<T> &x) {
-        if (x) {
-            s << std::static_pointer_cast<Operation>(x)->get_tag() << ",";
+    static void compose(std::string &s, const std::shared_ptr<T> &x) {
+        if (!x) {
+            return;
         }
+
+        const Operation *p = std::static_pointer_cast<Operation>(x).get();
+
+        if (Operation::describing_structure) {
+            s += '#';
+            s += p->get_tag();
+        } else {
+            s += p->describe();
+        }
+
+        s += ',';
     }
 };
 
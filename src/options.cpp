@@ -19,7 +19,10 @@
 #include <filesystem>
 #include <cstdlib>
 #include <cstring>
+#include <chrono>
+#include <map>
 #include <thread>
+#include <vector>
 
 #include <getopt.h>
 
@@ -42,6 +45,7 @@ namespace Flags {
 
     int dump_abridged_tags = 1;
     int dump_annotations = 1;
+    int count_events = 0;
 
     // Diagnostics
 
@@ -67,12 +71,18 @@ namespace Flags {
     // Evaluation
 
     int evaluate = 1;
+    int estimate = 0;
     int fold_transformations = 1;
     int fold_booleans = 1;
     int fold_flushes = 1;
     int eliminate_dead_operations = 1;
     int store_operations = 1;
     int load_operations = 1;
+    int migrate_store = 0;
+    int release_operations = 1;
+    int share_operations = 0;
+    int combine_units = 0;
+    int watch = 0;
 
     // Output
 
@@ -92,6 +102,7 @@ namespace Options {
     const char *dump_graph;
     const char *dump_operations;
     const char *dump_log;
+    const char *dump_trace;
     int dump_short_tags = -1;
 
     // Diagnostics
@@ -104,10 +115,16 @@ namespace Options {
     // Evaluation
 
     Language language = Language::AUTO;
-    int threads = 0; //std::thread::hardware_concurrency();
+    int threads = -1;
     int store_compression = 6;
     int store_threshold = 1;
+    int io_threads = 2;
+    int processes = 0;
+    int cache_limit = 1024;
     int rewrite_pass_limit = -1;
+    const char *store_directory;
+    const char *cost_database = "gamma.costs";
+    int cost_database_limit = 100000;
 
     // Output
 
@@ -147,6 +164,56 @@ static bool has_suffix(const char *s, const char *x)
     return false;
 }
 
+// An input file, to be re-evaluated when modified, in watch mode,
+// along with the modification times of the source files it was found
+// to depend on.
+
+struct Watched_input {
+    std::string path;
+    int (*run)(const char *input, char **first, char **last);
+    std::map<std::string, std::filesystem::file_time_type> times;
+};
+
+// Load a source file as a unit and evaluate it, unless units are to
+// be evaluated together, once all of them have been loaded.  If a
+// watched input is given, the source files the unit was loaded from
+// are added to it.
+
+static int run_unit(int (*run)(const char *input, char **first, char **last),
+                    const char *input, char **first, char **last,
+                    Watched_input *watched = nullptr)
+{
+    std::filesystem::path p(input);
+    std::string s = p.filename();
+
+    Options::include_directories.push_front(p.parent_path().native());
+
+    begin_unit(s.c_str());
+
+    const int r = run(input, first, last);
+
+    if (watched) {
+        for (const std::string &f: unit_files()) {
+            std::error_code e;
+            const auto t = std::filesystem::last_write_time(f, e);
+
+            if (!e) {
+                watched->times.insert({f, t});
+            }
+        }
+    }
+
+    if (r != 0) {
+        discard_unit();
+    } else if (!Flags::combine_units) {
+        evaluate_unit();
+    }
+
+    Options::include_directories.pop_front();
+
+    return r;
+}
+
 int parse_options(int argc, char *argv[])
 {
     enum {
@@ -156,12 +223,19 @@ int parse_options(int argc, char *argv[])
         DUMP_GRAPH,
         DUMP_OPERATIONS,
         DUMP_LOG,
+        DUMP_TRACE,
         DUMP_SHORT_TAGS,
         DIAGNOSTICS_SHORTEN_TAGS,
         POLYHEDRON_BOOLEANS,
         STORE_COMPRESSION,
         STORE_THRESHOLD,
-        REWRITE_PASS_LIMIT};
+        IO_THREADS,
+        PROCESSES,
+        CACHE_LIMIT,
+        REWRITE_PASS_LIMIT,
+        STORE_DIRECTORY,
+        COST_DATABASE,
+        COST_DATABASE_LIMIT};
 
     static struct option options[] = {
         {"help", no_argument, 0, 'h'},
@@ -173,12 +247,16 @@ int parse_options(int argc, char *argv[])
         {"no-dump-abridged-tags", no_argument, &Flags::dump_abridged_tags, 0},
         {"dump-annotations", no_argument, &Flags::dump_annotations, 1},
         {"no-dump-annotations", no_argument, &Flags::dump_annotations, 0},
+        {"count-events", no_argument, &Flags::count_events, 1},
+        {"no-count-events", no_argument, &Flags::count_events, 0},
         {"dump-graph", optional_argument, 0, DUMP_GRAPH},
         {"no-dump-graph", no_argument, 0, -DUMP_GRAPH},
         {"dump-operations", optional_argument, 0, DUMP_OPERATIONS},
         {"no-dump-operations", no_argument, 0, -DUMP_OPERATIONS},
         {"dump-log", optional_argument, 0, DUMP_LOG},
         {"no-dump-log", no_argument, 0, -DUMP_LOG},
+        {"dump-trace", optional_argument, 0, DUMP_TRACE},
+        {"no-dump-trace", no_argument, 0, -DUMP_TRACE},
         {"no-dump-short-tags", no_argument, &Options::dump_short_tags, -1},
         {"dump-short-tags", optional_argument, 0, DUMP_SHORT_TAGS},
         {"no-diagnostics-shorten-tags", no_argument, &Options::diagnostics_shorten_tags, -1},
@@ -197,6 +275,8 @@ int parse_options(int argc, char *argv[])
         {"no-threads", no_argument, &Options::threads, 0},
         {"evaluate", no_argument, &Flags::evaluate, 1},
         {"no-evaluate", no_argument, &Flags::evaluate, 0},
+        {"estimate", no_argument, &Flags::estimate, 1},
+        {"no-estimate", no_argument, &Flags::estimate, 0},
         {"fold-transformations", no_argument, &Flags::fold_transformations, 1},
         {"no-fold-transformations", no_argument, &Flags::fold_transformations, 0},
         {"fold-booleans", no_argument, &Flags::fold_booleans, 1},
@@ -210,12 +290,34 @@ int parse_options(int argc, char *argv[])
         {"no-store-operations", no_argument, &Flags::store_operations, 0},
         {"load-operations", no_argument, &Flags::load_operations, 1},
         {"no-load-operations", no_argument, &Flags::load_operations, 0},
+        {"migrate-store", no_argument, &Flags::migrate_store, 1},
+        {"no-migrate-store", no_argument, &Flags::migrate_store, 0},
+        {"release-operations", no_argument, &Flags::release_operations, 1},
+        {"no-release-operations", no_argument, &Flags::release_operations, 0},
         {"store-compression", optional_argument, 0, STORE_COMPRESSION},
         {"no-store-compression", no_argument, &Options::store_compression, -1},
         {"rewrite-pass-limit", required_argument, 0, REWRITE_PASS_LIMIT},
         {"no-rewrite-pass-limit", no_argument, &Options::rewrite_pass_limit, -1},
+        {"store-directory", required_argument, 0, STORE_DIRECTORY},
         {"store-threshold", required_argument, 0, STORE_THRESHOLD},
         {"no-store-threshold", no_argument, &Options::store_threshold, 0},
+        {"io-threads", required_argument, 0, IO_THREADS},
+        {"no-io-threads", no_argument, &Options::io_threads, 0},
+        {"processes", required_argument, 0, PROCESSES},
+        {"no-processes", no_argument, &Options::processes, 0},
+        {"share-operations", no_argument, &Flags::share_operations, 1},
+        {"no-share-operations", no_argument, &Flags::share_operations, 0},
+        {"combine-units", no_argument, &Flags::combine_units, 1},
+        {"no-combine-units", no_argument, &Flags::combine_units, 0},
+        {"watch", no_argument, &Flags::watch, 1},
+        {"no-watch", no_argument, &Flags::watch, 0},
+        {"cache-limit", required_argument, 0, CACHE_LIMIT},
+        {"no-cache-limit", no_argument, &Options::cache_limit, -1},
+        {"cost-database", required_argument, 0, COST_DATABASE},
+        {"no-cost-database", no_argument, 0, -COST_DATABASE},
+        {"cost-database-limit", required_argument, 0, COST_DATABASE_LIMIT},
+        {"no-cost-database-limit", no_argument,
+         &Options::cost_database_limit, -1},
 
         // Output
 
@@ -334,6 +436,9 @@ int parse_options(int argc, char *argv[])
 
     optind = 1;
 
+    std::vector<Watched_input> watched;
+    bool combined = false;
+
     int n, option;
     while ((n = -1, option = getopt_long(
                 argc_max, argv,
@@ -381,21 +486,24 @@ int parse_options(int argc, char *argv[])
 
             /* Load and evaluate the source file. */
 
-            std::filesystem::path p(optarg);
-            std::string s = p.filename();
+            Watched_input *w = nullptr;
 
-            Options::include_directories.push_front(p.parent_path().native());
+            if (Flags::watch) {
+                std::error_code e;
 
-            begin_unit(s.c_str());
+                w = &watched.emplace_back();
+                w->path = optarg;
+                w->run = run;
+                w->times[optarg] = std::filesystem::last_write_time(optarg, e);
+            }
 
-            if (run(optarg, argv + argc_max, argv + argc) != 0) {
+            if (run_unit(
+                    run, optarg, argv + argc_max, argv + argc, w) == 0) {
+                combined = Flags::combine_units;
+            } else if (!Flags::watch) {
                 return -EXIT_FAILURE;
             }
 
-            evaluate_unit();
-
-            Options::include_directories.pop_front();
-
             break;
         }
 
@@ -428,18 +536,25 @@ int parse_options(int argc, char *argv[])
                     "Debugging options:\n"
                     "  --dump-operations[=FILE] Dump evaluated operations.\n"
                     "  --dump-log[=FILE]        Dump evaluation log.\n"
+                    "  --dump-trace[=FILE]      Dump evaluation timeline, in trace event format.\n"
                     "  --dump-graph[=FILE]      Dump evaluation graph.\n"
                     "  --no-dump-abridged-tags  Do not substitute operands in dumped operation\n"
                     "                           tags with evaluation sequence numbers.\n"
                     "  --no-dump-annotations    Do not annotate dumped operations.\n"
+                    "  --count-events           Count hardware events, such as cycles and cache\n"
+                    "                           misses, during the evaluation of each operation\n"
+                    "                           and annotate it with the counts.\n"
                     "  --dump-short-tags[=N]    Limit the maximum length in dumped tags.\n\n"
 
                     "Evaluation options:\n"
                     "  -t N, --threads=N     Use no more than specified number of evaluation threads.\n"
+                    "                        By default, use as many as there are available processors.\n"
                     "  --polyhedron-booleans=MODE\n"
                     "                        Set polyhedron boolean operation execution strategy.\n"
                     "                        MODE can be one of 'nef', 'auto'.\n"
                     "  --no-evaluate         Go through the motions, but don't evaluate anything.\n"
+                    "  --estimate            Estimate the time and memory evaluation would take,\n"
+                    "                        based on recorded costs, instead of evaluating.\n"
                     "  --no-fold-transformations\n"
                     "                        Disable transformation operation folding.\n"
                     "  --no-fold-booleans    Disable boolean operation folding.\n"
@@ -448,12 +563,44 @@ int parse_options(int argc, char *argv[])
                     "                        Do not skip evaluation of unneeded operations.\n"
                     "  --no-store-operations Do not store evaluated operations to disk.\n"
                     "  --no-load-operations  Do not load stored operations from disk.\n"
+                    "  --migrate-store       Rename operations stored by earlier versions, as they\n"
+                    "                        are loaded, so that they remain loadable.\n"
+                    "  --no-release-operations\n"
+                    "                        Do not release the results of intermediate operations\n"
+                    "                        once they are no longer needed.\n"
+                    "  --store-directory=DIR Store operations, and their costs, in DIR, instead of\n"
+                    "                        the working directory.\n"
                     "  --store-compression[=LEVEL]\n"
                     "                        Compress stored operations.\n"
                     "  --no-store-compression Do not compress stored operations.\n"
                     "  --store-threshold[=N] Don't store operations with cumulative evaluation\n"
                     "                        time below the specified threshold (in seconds).\n"
                     "  --no-store-threshold  Store all operations, irrespective of evaluation time.\n"
+                    "  --io-threads=N        Load and store operations in the background, using N\n"
+                    "                        threads.\n"
+                    "  --no-io-threads       Load and store operations in the evaluating thread.\n"
+                    "  --processes=N         Evaluate operations that can't be evaluated in worker\n"
+                    "                        threads in up to N child processes.\n"
+                    "  --no-processes        Evaluate all operations within the process.\n"
+                    "  --share-operations    Retain evaluated operations in memory, so that they\n"
+                    "                        can be reused when evaluating subsequent input files.\n"
+                    "                        Intermediate results are then not released.\n"
+                    "  --combine-units       Build the operations of all input files first, then\n"
+                    "                        evaluate them together.\n"
+                    "  --watch               Stay resident and re-evaluate input files when they,\n"
+                    "                        or the files they load, change, retaining evaluated\n"
+                    "                        operations in memory.\n"
+                    "  --cache-limit=N       Evict retained operations no longer in use, when\n"
+                    "                        they occupy more than N megabytes.\n"
+                    "  --no-cache-limit      Never evict retained operations.\n"
+                    "  --cost-database=FILE  Record the costs of evaluated operations in FILE,\n"
+                    "                        relative to the store directory, to guide subsequent\n"
+                    "                        evaluations.  The file is only updated when\n"
+                    "                        operations are stored.\n"
+                    "  --no-cost-database    Do not record the costs of evaluated operations.\n"
+                    "  --cost-database-limit=N Keep the costs of at most N operations, pruning\n"
+                    "                        those used least recently.\n"
+                    "  --no-cost-database-limit Never prune the cost database.\n"
                     "  --rewrite-pass-limit=N Perform at most N rewrite passes.\n\n"
 
 
@@ -562,6 +709,12 @@ int parse_options(int argc, char *argv[])
         case -DUMP_LOG:
             STRING_OPTION(dump_log);
 
+        case DUMP_TRACE:
+            OPTIONAL_ARGUMENT(dump_trace, "\0");
+            [[fallthrough]];
+        case -DUMP_TRACE:
+            STRING_OPTION(dump_trace);
+
         case DUMP_SHORT_TAGS:
             OPTIONAL_ARGUMENT(dump_short_tags, 50);
             INTEGER_OPTION(dump_short_tags, i >= 0);
@@ -586,9 +739,31 @@ int parse_options(int argc, char *argv[])
         case STORE_THRESHOLD:
             INTEGER_OPTION(store_threshold, i >= 0);
 
+        case IO_THREADS:
+            INTEGER_OPTION(io_threads, i >= 0);
+
+        case PROCESSES:
+            INTEGER_OPTION(processes, i >= 0);
+
+        case CACHE_LIMIT:
+            INTEGER_OPTION(cache_limit, i >= 0);
+
         case REWRITE_PASS_LIMIT:
             INTEGER_OPTION(rewrite_pass_limit, i >= 0);
 
+        case -COST_DATABASE:
+            Options::cost_database = nullptr;
+            break;
+
+        case STORE_DIRECTORY:
+            STRING_OPTION(store_directory);
+
+        case COST_DATABASE:
+            STRING_OPTION(cost_database);
+
+        case COST_DATABASE_LIMIT:
+            INTEGER_OPTION(cost_database_limit, i >= 0);
+
         case 't': INTEGER_OPTION(threads, i >= 0);
 
         case 'W':
@@ -696,8 +871,66 @@ int parse_options(int argc, char *argv[])
 
 #undef OPTION_END
 
+    // Evaluate combined units.
+
+    if (combined) {
+        evaluate_unit();
+    }
+
+    // In watch mode, stay resident and re-evaluate each input file,
+    // whenever it, or any other source file it was found to depend
+    // on, is modified.  The input is run anew, but operations
+    // evaluated previously are adopted from memory.
+
+    while (!watched.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        combined = false;
+
+        for (Watched_input &x: watched) {
+            bool modified = false;
+
+            for (const auto &[f, t]: x.times) {
+                std::error_code e;
+
+                if (std::filesystem::last_write_time(f, e) != t && !e) {
+                    modified = true;
+                    break;
+                }
+            }
+
+            if (!modified) {
+                continue;
+            }
+
+            // Collect the dependencies anew, as they may have changed.
+
+            std::error_code e;
+
+            x.times.clear();
+            x.times[x.path] = std::filesystem::last_write_time(x.path, e);
+
+            if (run_unit(x.run, x.path.c_str(),
+                         argv + argc_max, argv + argc, &x) == 0) {
+                combined = Flags::combine_units;
+            }
+        }
+
+        if (combined) {
+            evaluate_unit();
+        }
+    }
+
     // This essentially returns the number of options successfully
     // parsed (mainly useful for testing).
 
     return optind;
 }
+
+std::string store_file_path(const std::string &name)
+{
+    if (!Options::store_directory) {
+        return name;
+    }
+
+    return (std::filesystem::path(Options::store_directory) / name).string();
+}
@@ -51,6 +51,7 @@ namespace Flags {
 
     extern int dump_abridged_tags;
     extern int dump_annotations;
+    extern int count_events;
 
     // Diagnostics
 
@@ -76,12 +77,18 @@ namespace Flags {
     // Evaluation
 
     extern int evaluate;
+    extern int estimate;
     extern int fold_transformations;
     extern int fold_booleans;
     extern int fold_flushes;
     extern int eliminate_dead_operations;
     extern int store_operations;
     extern int load_operations;
+    extern int migrate_store;
+    extern int release_operations;
+    extern int share_operations;
+    extern int combine_units;
+    extern int watch;
 
     // Output
 
@@ -101,6 +108,7 @@ namespace Options {
     extern const char *dump_graph;
     extern const char *dump_operations;
     extern const char *dump_log;
+    extern const char *dump_trace;
     extern int dump_short_tags;
     extern int diagnostics_shorten_tags;
 
@@ -116,6 +124,12 @@ namespace Options {
     extern int rewrite_pass_limit;
     extern int store_compression;
     extern int store_threshold;
+    extern int io_threads;
+    extern int processes;
+    extern int cache_limit;
+    extern const char *store_directory;
+    extern const char *cost_database;
+    extern int cost_database_limit;
 
     // Output
 
@@ -134,4 +148,9 @@ namespace Options {
 
 int parse_options(int argc, char* argv[]);
 
+// The path of a file in the store directory, i.e. the working
+// directory, unless otherwise specified.
+
+std::string store_file_path(const std::string &name);
+
 #endif
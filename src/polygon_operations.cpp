@@ -239,7 +239,7 @@ void Polygon_offset_operation::evaluate()
     Polygon_set &S = *operand->get_value();
 
     if (offset == 0) {
-        polygon = std::make_shared<Polygon_set>(S);
+        polygon = operand->take_value();
         return;
     }
 
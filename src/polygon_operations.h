@@ -111,12 +111,17 @@ void transform_polygon_set(
 }
 
 template<typename T>
-class Polygon_operation: public Operation {
+class Polygon_operation: public Threadsafe_operation {
 protected:
     std::shared_ptr<T> polygon;
 
 public:
-    Polygon_operation(): polygon(nullptr) {}
+    Polygon_operation():
+        Threadsafe_operation(is_threadsafe_polygon_set<T>::value),
+        polygon(nullptr) {}
+    Polygon_operation(const bool p):
+        Threadsafe_operation(p && is_threadsafe_polygon_set<T>::value),
+        polygon(nullptr) {}
 
     bool dispatch() override {
         bool p = Operation::dispatch();
@@ -149,8 +154,76 @@ public:
         return polygon;
     };
 
+    // Get the result for modification by a successor.  If the caller
+    // is the last successor to consume it and it's not needed
+    // otherwise, ownership of the result is transferred to the
+    // caller, or else a copy is made.
+
+    std::shared_ptr<T> take_value() {
+        assert(polygon);
+
+        if (disposable
+            && consumers == 1
+            && polygon.use_count() == 1) {
+            return std::move(polygon);
+        }
+
+        return std::make_shared<T>(*polygon);
+    };
+
+    std::size_t size() const override {
+        using Arrangement = typename T::Arrangement_2;
+
+        if (!polygon) {
+            return 0;
+        }
+
+        const Arrangement &A = polygon->arrangement();
+        std::size_t n = 0;
+
+        // Only account for exact coordinates of linear polygons;
+        // those of other curves are represented differently.
+
+        if constexpr (std::is_same_v<typename Arrangement::Point_2, Point_2>) {
+            for (auto v = A.vertices_begin(); v != A.vertices_end(); ++v) {
+                n += exact_size(v->point());
+            }
+        }
+
+        return (n
+                + A.number_of_vertices()
+                * (sizeof(typename Arrangement::Vertex)
+                   + sizeof(typename Arrangement::Point_2))
+                + A.number_of_edges()
+                * (2 * sizeof(typename Arrangement::Halfedge)
+                   + sizeof(typename Arrangement::X_monotone_curve_2))
+                + A.number_of_faces() * sizeof(typename Arrangement::Face));
+    }
+
+    void release() override {
+        polygon.reset();
+    }
+
+    std::shared_ptr<void> get_result() const override {
+        return polygon;
+    }
+
+    void set_result(const std::shared_ptr<void> &p) override {
+        polygon = std::static_pointer_cast<T>(p);
+    }
+
     bool store() override;
     bool load() override;
+
+    bool transferable() const override {
+        return is_storable_polygon_set<T>::value;
+    }
+};
+
+template<typename T>
+class Unsafe_polygon_operation: public Polygon_operation<T> {
+public:
+    Unsafe_polygon_operation(): Polygon_operation<T>(false) {}
 };
 
 // Primitives
@@ -18,6 +18,8 @@
 #ifndef POLYGON_TYPES_H
 #define POLYGON_TYPES_H
 
+#include <type_traits>
+
 #include <CGAL/Polygon_2.h>
 #include <CGAL/Polygon_with_holes_2.h>
 #include <CGAL/Polygon_set_2.h>
@@ -26,4 +28,16 @@ typedef CGAL::Polygon_2<Kernel> Polygon;
 typedef CGAL::Polygon_with_holes_2<Kernel> Polygon_with_holes;
 typedef CGAL::Polygon_set_2<Kernel> Polygon_set;
 
+// Whether polygon sets of type T can be constructed, or accessed, off
+// the main thread.
+
+template<typename T>
+struct is_threadsafe_polygon_set: std::true_type {};
+
+// Whether polygon sets of type T can be stored, i.e. written to and
+// read back from a file.
+
+template<typename T>
+struct is_storable_polygon_set: std::true_type {};
+
 #endif
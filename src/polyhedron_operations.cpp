@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <sstream>
+
 #include <CGAL/exceptions.h>
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
 #include <CGAL/IO/Nef_polyhedron_iostream_3.h>
@@ -29,11 +31,13 @@
 
 #include "assertions.h"
 #include "iterators.h"
+#include "cancellation.h"
 #include "compressed_stream.h"
 #include "options.h"
 #include "kernel.h"
 #include "projection.h"
 #include "polyhedron_operations.h"
+#include "trace.h"
 
 #include <CGAL/Polygon_mesh_processing/self_intersections.h>
 #include <CGAL/Polygon_mesh_processing/orientation.h>
@@ -148,7 +152,13 @@ bool Polyhedron_operation<Polyhedron>::dispatch()
                 {"halfedges", std::to_string(polyhedron->size_of_halfedges())},
                 {"facets", std::to_string(polyhedron->size_of_facets())}});
 
+        const auto t_0 = Trace_clock::now();
+
         test_result(this, *polyhedron);
+
+        if (tracing()) {
+            trace_span("check", "check", t_0, Trace_clock::now());
+        }
     }
 
     return p;
@@ -184,16 +194,113 @@ bool Polyhedron_operation<Surface_mesh>::dispatch()
                 {"edges", std::to_string(polyhedron->number_of_edges())},
                 {"facets", std::to_string(polyhedron->number_of_faces())}});
 
+        const auto t_0 = Trace_clock::now();
+
         test_result(this, *polyhedron);
+
+        if (tracing()) {
+            trace_span("check", "check", t_0, Trace_clock::now());
+        }
     }
 
     return p;
 }
 
+// Lazy kernel points are handles to a shared representation, which
+// holds an interval approximation of the coordinates and, if they
+// have been computed, their exact values, which are accounted for
+// separately.
+
+static const std::size_t point_size =
+    sizeof(Point_3) + 3 * sizeof(CGAL::Interval_nt<false>);
+
+template<>
+std::size_t Polyhedron_operation<Polyhedron>::size() const
+{
+    if (!polyhedron) {
+        return 0;
+    }
+
+    std::size_t n = 0;
+
+    for (auto v = polyhedron->vertices_begin();
+         v != polyhedron->vertices_end();
+         ++v) {
+        n += exact_size(v->point());
+    }
+
+    return (n
+            + polyhedron->size_of_vertices()
+            * (sizeof(Polyhedron::Vertex) + point_size)
+            + polyhedron->size_of_halfedges() * sizeof(Polyhedron::Halfedge)
+            + polyhedron->size_of_facets() * sizeof(Polyhedron::Facet));
+}
+
+// Halffacets also hold their supporting plane, which is shared
+// between the two halffacets of each facet.
+
+template<>
+std::size_t Polyhedron_operation<Nef_polyhedron>::size() const
+{
+    if (!polyhedron) {
+        return 0;
+    }
+
+    std::size_t n = 0;
+
+    for (auto v = polyhedron->vertices_begin();
+         v != polyhedron->vertices_end();
+         ++v) {
+        n += exact_size(v->point());
+    }
+
+    for (auto f = polyhedron->halffacets_begin();
+         f != polyhedron->halffacets_end();
+         ++f) {
+        n += exact_size(f->plane()) / 2;
+    }
+
+    return (n
+            + polyhedron->number_of_vertices()
+            * (sizeof(Nef_polyhedron::Vertex) + point_size)
+            + polyhedron->number_of_halfedges()
+            * sizeof(Nef_polyhedron::Halfedge)
+            + polyhedron->number_of_halffacets()
+            * sizeof(Nef_polyhedron::Halffacet)
+            + polyhedron->number_of_volumes()
+            * sizeof(Nef_polyhedron::Volume));
+}
+
+template<>
+std::size_t Polyhedron_operation<Surface_mesh>::size() const
+{
+    if (!polyhedron) {
+        return 0;
+    }
+
+    // Surface meshes store the halfedge of each vertex and face and
+    // the face, vertex, next and previous halfedge of each halfedge.
+
+    std::size_t n = 0;
+
+    for (const Point_3 &P: polyhedron->points()) {
+        n += exact_size(P);
+    }
+
+    return (n
+            + polyhedron->number_of_vertices()
+            * (sizeof(Surface_mesh::Halfedge_index) + point_size)
+            + polyhedron->number_of_halfedges()
+            * (sizeof(Surface_mesh::Face_index)
+               + sizeof(Surface_mesh::Vertex_index)
+               + 2 * sizeof(Surface_mesh::Halfedge_index))
+            + polyhedron->number_of_faces()
+            * sizeof(Surface_mesh::Halfedge_index));
+}
+
 template<>
 bool Polyhedron_operation<Nef_polyhedron>::store()
 {
-    assert(Flags::store_operations);
     assert(polyhedron);
 
     compressed_ofstream_wrapper f(Options::store_compression);
@@ -223,7 +330,6 @@ bool Polyhedron_operation<Nef_polyhedron>::store()
 template<>
 bool Polyhedron_operation<Nef_polyhedron>::load()
 {
-    assert(Flags::load_operations);
     assert(!polyhedron);
 
     compressed_ifstream_wrapper f(Options::store_compression >= 0);
@@ -258,7 +364,6 @@ bool Polyhedron_operation<T>::store()
 {
     using traits = typename boost::graph_traits<T>;
 
-    assert(Flags::store_operations);
     assert(polyhedron);
 
     compressed_ofstream_wrapper f(Options::store_compression);
@@ -329,7 +434,6 @@ bool Polyhedron_operation<T>::load()
     typedef typename boost::property_map<T, CGAL::vertex_point_t>::type Vertex_point_map;
     typedef typename boost::property_traits<Vertex_point_map>::value_type Point;
 
-    assert(Flags::load_operations);
     assert(!polyhedron);
 
     compressed_ifstream_wrapper f(Options::store_compression >= 0);
@@ -447,7 +551,8 @@ void Polyhedron_convert_operation<Polyhedron, Surface_mesh>::evaluate()
     CGAL::copy_face_graph(*operand->get_value(), *polyhedron);
 }
 
-// Convert to Nef_polyhedron
+// Convert to Nef_polyhedron.  Nef polyhedron construction offers no
+// hooks for cancellation, so check in between the individual steps.
 
 template<typename T>
 void Polyhedron_convert_operation<Nef_polyhedron, T>::evaluate()
@@ -464,10 +569,14 @@ void Polyhedron_convert_operation<Nef_polyhedron, T>::evaluate()
         p = CGAL::Polygon_mesh_processing::is_outward_oriented(Q);
     }
 
+    Operation::check_cancellation();
+
     if (p) {
         this->polyhedron = std::make_shared<Nef_polyhedron>(P);
     } else {
         Nef_polyhedron N(P);
+
+        Operation::check_cancellation();
         this->polyhedron = std::make_shared<Nef_polyhedron>(
             N.complement().closure());
     }
@@ -510,7 +619,7 @@ void Polyhedron_transform_operation<Polyhedron>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Polyhedron>(*operand->get_value());
+    polyhedron = operand->take_value();
     std::transform(polyhedron->points_begin(), polyhedron->points_end(),
                    polyhedron->points_begin(), transformation);
 
@@ -524,7 +633,7 @@ void Polyhedron_transform_operation<Nef_polyhedron>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Nef_polyhedron>(*operand->get_value());
+    polyhedron = operand->take_value();
     polyhedron->transform(transformation);
 }
 
@@ -533,7 +642,7 @@ void Polyhedron_transform_operation<Surface_mesh>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Surface_mesh>(*operand->get_value());
+    polyhedron = operand->take_value();
 
     CGAL::Polygon_mesh_processing::transform(transformation, *polyhedron);
 
@@ -549,7 +658,7 @@ void Polyhedron_flush_operation<T>::evaluate()                          \
 {                                                                       \
     assert(!polyhedron);                                                \
                                                                         \
-    polyhedron = std::make_shared<T>(*operand->get_value());            \
+    polyhedron = operand->take_value();                                 \
                                                                         \
     T &P = *polyhedron;                                                 \
     FT x_min, x_max, y_min, y_max, z_min, z_max;                        \
@@ -689,6 +798,7 @@ void Polyhedron_## OP ##_operation<Nef_polyhedron>::evaluate()          \
         for (const Nef_polyhedron &X: {N, M}) {                         \
             Surface_mesh S;                                             \
                                                                         \
+            Operation::check_cancellation();                            \
             CGAL::convert_nef_polyhedron_to_polygon_mesh(X, S, true);   \
             if (CGAL::Polygon_mesh_processing::does_self_intersect(S)   \
                 || !CGAL::Polygon_mesh_processing::does_bound_a_volume(S)) { \
@@ -698,6 +808,7 @@ void Polyhedron_## OP ##_operation<Nef_polyhedron>::evaluate()          \
         }                                                               \
     }                                                                   \
                                                                         \
+    Operation::check_cancellation();                                    \
     this->polyhedron = std::make_shared<Nef_polyhedron>(N.OP(M));       \
                                                                         \
     WARN_NEF(this, input_corefinable);                                  \
@@ -709,14 +820,15 @@ void Polyhedron_## OP ##_operation<T>::evaluate()                       \
     assert(!this->polyhedron);                                          \
                                                                         \
     T P = *this->first->get_value();                                    \
-    this->polyhedron = std::make_shared<T>(                             \
-        *this->second->get_value());                                    \
+    this->polyhedron = this->second->take_value();                      \
                                                                         \
     CGAL::Polygon_mesh_processing::triangulate_faces(                   \
         CGAL::faces(*this->polyhedron), *this->polyhedron);             \
     CGAL::Polygon_mesh_processing::triangulate_faces(CGAL::faces(P), P);\
                                                                         \
-    if (!COOP(P, *this->polyhedron, *this->polyhedron)) {               \
+    if (!COOP(P, *this->polyhedron, *this->polyhedron,                  \
+              CGAL::Polygon_mesh_processing::parameters::visitor(       \
+                  Cancelling_corefinement_visitor<T>()))) {             \
         CGAL_error_msg("resulting mesh would not be manifold");         \
     }                                                                   \
 }                                                                       \
@@ -744,7 +856,7 @@ void Polyhedron_complement_operation<Polyhedron>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Polyhedron>(*operand->get_value());
+    polyhedron = operand->take_value();
     polyhedron->inside_out();
 }
 
@@ -762,7 +874,7 @@ void Polyhedron_complement_operation<Surface_mesh>::evaluate()
 {
     assert(!polyhedron);
 
-    polyhedron = std::make_shared<Surface_mesh>(*operand->get_value());
+    polyhedron = operand->take_value();
     CGAL::Polygon_mesh_processing::reverse_face_orientations(*polyhedron);
 }
 
@@ -778,15 +890,21 @@ void Polyhedron_boundary_operation::evaluate()
 // Subdivision operations //
 ////////////////////////////
 
+// Subdivision is carried out one level at a time, so that it can be
+// abandoned in between, if evaluation is cancelled.
+
 template<typename T>
 void Loop_subdivision_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
-    CGAL::Subdivision_method_3::Loop_subdivision(
-        *this->polyhedron, CGAL::parameters::number_of_iterations(this->depth));
+    for (unsigned int i = 0; i < this->depth; i++) {
+        Operation::check_cancellation();
+        CGAL::Subdivision_method_3::Loop_subdivision(
+            *this->polyhedron, CGAL::parameters::number_of_iterations(1));
+    }
 }
 
 template void Loop_subdivision_operation<Polyhedron>::evaluate();
@@ -797,10 +915,13 @@ void Catmull_clark_subdivision_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
-    CGAL::Subdivision_method_3::CatmullClark_subdivision(
-        *this->polyhedron, CGAL::parameters::number_of_iterations(this->depth));
+    for (unsigned int i = 0; i < this->depth; i++) {
+        Operation::check_cancellation();
+        CGAL::Subdivision_method_3::CatmullClark_subdivision(
+            *this->polyhedron, CGAL::parameters::number_of_iterations(1));
+    }
 }
 
 template void Catmull_clark_subdivision_operation<Polyhedron>::evaluate();
@@ -811,10 +932,13 @@ void Doo_sabin_subdivision_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
-    CGAL::Subdivision_method_3::DooSabin_subdivision(
-        *this->polyhedron, CGAL::parameters::number_of_iterations(this->depth));
+    for (unsigned int i = 0; i < this->depth; i++) {
+        Operation::check_cancellation();
+        CGAL::Subdivision_method_3::DooSabin_subdivision(
+            *this->polyhedron, CGAL::parameters::number_of_iterations(1));
+    }
 }
 
 template void Doo_sabin_subdivision_operation<Polyhedron>::evaluate();
@@ -825,10 +949,13 @@ void Sqrt_3_subdivision_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
-    CGAL::Subdivision_method_3::Sqrt3_subdivision(
-        *this->polyhedron, CGAL::parameters::number_of_iterations(this->depth));
+    for (unsigned int i = 0; i < this->depth; i++) {
+        Operation::check_cancellation();
+        CGAL::Subdivision_method_3::Sqrt3_subdivision(
+            *this->polyhedron, CGAL::parameters::number_of_iterations(1));
+    }
 }
 
 template void Sqrt_3_subdivision_operation<Polyhedron>::evaluate();
@@ -979,6 +1106,7 @@ void Polyhedron_clip_operation<Nef_polyhedron>::evaluate()
         }
     }
 
+    Operation::check_cancellation();
     this->polyhedron = std::make_shared<Nef_polyhedron>(
         N.intersection(
             plane, Nef_polyhedron::Intersection_mode::CLOSED_HALFSPACE));
@@ -991,7 +1119,7 @@ void Polyhedron_clip_operation<T>::evaluate()
 {
     assert(!this->polyhedron);
 
-    this->polyhedron = std::make_shared<T>(*this->operand->get_value());
+    this->polyhedron = this->operand->take_value();
 
     CGAL::Polygon_mesh_processing::triangulate_faces(
         CGAL::faces(*this->polyhedron), *this->polyhedron);
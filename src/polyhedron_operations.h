@@ -41,8 +41,42 @@ public:
         return polyhedron;
     };
 
+    // Get the result for modification by a successor.  If the caller
+    // is the last successor to consume it and it's not needed
+    // otherwise, ownership of the result is transferred to the
+    // caller, or else a copy is made.
+
+    std::shared_ptr<T> take_value() {
+        assert(polyhedron);
+
+        if (disposable
+            && consumers == 1
+            && polyhedron.use_count() == 1) {
+            return std::move(polyhedron);
+        }
+
+        return std::make_shared<T>(*polyhedron);
+    };
+
     bool store() override;
     bool load() override;
+    std::size_t size() const override;
+
+    bool transferable() const override {
+        return true;
+    }
+
+    void release() override {
+        polyhedron.reset();
+    }
+
+    std::shared_ptr<void> get_result() const override {
+        return polyhedron;
+    }
+
+    void set_result(const std::shared_ptr<void> &p) override {
+        polyhedron = std::static_pointer_cast<T>(p);
+    }
 };
 
 template<typename T>
@@ -15,6 +15,9 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <unordered_map>
+#include <vector>
+
 #include "kernel.h"
 #include "polygon_operations.h"
 #include "circle_polygon_types.h"
@@ -35,14 +38,46 @@ static void update_annotation(Operation *op)
     }
 }
 
+// Retag an operation, along with the operations depending on it, as
+// tags are computed from the tags of operands.  Each operation is
+// retagged once, after all of its predecessors that need retagging,
+// in a walk with an explicit stack, as the graph can be arbitrarily
+// deep.
+
 static void retag(Operation *op)
 {
-    const std::string k = op->get_tag();
-    op->reset_tag();
-    rehash_operation(k);
+    std::unordered_map<Operation *, int> pending = {{op, 0}};
+    std::vector<Operation *> v = {op};
+
+    // Count the predecessors of each dependent operation that need
+    // retagging.
 
-    for (Operation *x: op->successors) {
-        retag(x);
+    while (!v.empty()) {
+        Operation *x = v.back();
+        v.pop_back();
+
+        for (Operation *y: x->successors) {
+            if (pending[y]++ == 0) {
+                v.push_back(y);
+            }
+        }
+    }
+
+    v.push_back(op);
+
+    while (!v.empty()) {
+        Operation *x = v.back();
+        v.pop_back();
+
+        const std::string k = x->get_tag();
+        x->reset_tag();
+        rehash_operation(k);
+
+        for (Operation *y: x->successors) {
+            if (--pending.at(y) == 0) {
+                v.push_back(y);
+            }
+        }
     }
 }
 
@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License along with
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <sstream>
+
 #include <chibi/sexp.h>
 #include <chibi/install.h>
 
@@ -376,6 +378,32 @@ static sexp output(sexp ctx, sexp self, sexp_sint_t n, sexp args)
     return t;
 }
 
+// Pin the given polygons or polyhedra, so that their results are
+// retained after evaluation of the operations that consume them.
+// Returns the last of them.
+
+static sexp pin(sexp ctx, sexp self, sexp_sint_t n, sexp args)
+{
+    sexp t = SEXP_VOID;
+
+    while (pop_optional(args, t)) {
+        auto f = [](auto &&x) {
+            x->pinned = true;
+        };
+
+        if (sexp_isa(t, foreign_type<Boxed_polyhedron>)) {
+            std::visit(f, from_scheme<Boxed_polyhedron>(t));
+        } else if (sexp_isa(t, foreign_type<Boxed_polygon>)) {
+            std::visit(f, from_scheme<Boxed_polygon>(t));
+        } else {
+            return make_type_exception(
+                ctx, self, "invalid type, expected polygon or polyhedron", t);
+        }
+    }
+
+    return t;
+}
+
 static sexp define_option(sexp ctx, sexp self, sexp_sint_t n, sexp s, sexp t)
 {
     if (sexp_env_ref(ctx, sexp_context_env(ctx), s, SEXP_UNDEF) == SEXP_UNDEF) {
@@ -1459,6 +1487,7 @@ sexp init_base(
     sexp_define_foreign_proc_rest(
         ctx, env, "%define-option", 2, reinterpret_cast<void *>(define_option));
     DEFINE_FOREIGN("output", output);
+    DEFINE_FOREIGN("pin", pin);
     DEFINE_FOREIGN("point", point);
     DEFINE_FOREIGN("plane", make_primitive<plane, Plane_3, 4>);
 
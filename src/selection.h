@@ -331,9 +331,10 @@ struct compose_tag_helper<std::shared_ptr<T>,
                               std::is_same_v<Face_selector, T>
                               || std::is_same_v<Vertex_selector, T>
                               || std::is_same_v<Edge_selector, T>>> {
-    static void compose(std::ostringstream &s, const std::shared_ptr<T> &x) {
+    static void compose(std::string &s, const std::shared_ptr<T> &x) {
         if (x) {
-            s << x->describe() << ",";
+            s += x->describe();
+            s += ',';
         }
     }
 };
@@ -0,0 +1,198 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef SMALL_SET_H
+#define SMALL_SET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// A set of trivially copyable values, such as pointers, kept in
+// insertion order in a contiguous array, the first N elements of
+// which are stored inline.  Lookup is linear, so that it's only
+// suitable for small sets, such as the predecessors and successors of
+// operations, which mostly number one or two.
+
+template<typename T, std::size_t N = 2>
+class Small_set {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    std::uint32_t n, m;         // Size and capacity.
+
+    union {
+        T local[N];
+        T *remote;
+    };
+
+    T *data() {
+        return m > N ? remote : local;
+    }
+
+    const T *data() const {
+        return m > N ? remote : local;
+    }
+
+    void reserve(const std::uint32_t k) {
+        if (k <= m) {
+            return;
+        }
+
+        T *p = new T[k];
+
+        std::memcpy(p, data(), n * sizeof(T));
+
+        if (m > N) {
+            delete[] remote;
+        }
+
+        remote = p;
+        m = k;
+    }
+
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    Small_set(): n(0), m(N) {}
+
+    Small_set(const Small_set &other): Small_set() {
+        *this = other;
+    }
+
+    Small_set(Small_set &&other): Small_set() {
+        *this = std::move(other);
+    }
+
+    ~Small_set() {
+        if (m > N) {
+            delete[] remote;
+        }
+    }
+
+    Small_set &operator=(const Small_set &other) {
+        if (this != &other) {
+            n = 0;
+            reserve(other.n);
+            std::memcpy(data(), other.data(), other.n * sizeof(T));
+            n = other.n;
+        }
+
+        return *this;
+    }
+
+    Small_set &operator=(Small_set &&other) {
+        if (this == &other) {
+            return *this;
+        }
+
+        if (m > N) {
+            delete[] remote;
+        }
+
+        n = std::exchange(other.n, 0);
+        m = std::exchange(other.m, N);
+
+        if (m > N) {
+            remote = other.remote;
+        } else {
+            std::memcpy(local, other.local, n * sizeof(T));
+        }
+
+        return *this;
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    iterator end() {
+        return data() + n;
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + n;
+    }
+
+    std::size_t size() const {
+        return n;
+    }
+
+    bool empty() const {
+        return n == 0;
+    }
+
+    iterator find(const T &x) {
+        return std::find(begin(), end(), x);
+    }
+
+    const_iterator find(const T &x) const {
+        return std::find(begin(), end(), x);
+    }
+
+    std::size_t count(const T &x) const {
+        return find(x) != end();
+    }
+
+    std::pair<iterator, bool> insert(const T &x) {
+        if (iterator it = find(x); it != end()) {
+            return {it, false};
+        }
+
+        if (n == m) {
+            reserve(2 * m);
+        }
+
+        T *p = data() + n++;
+        *p = x;
+
+        return {p, true};
+    }
+
+    // Erasure preserves the order of the remaining elements.
+
+    iterator erase(const_iterator it) {
+        iterator p = begin() + (it - begin());
+
+        std::memmove(p, p + 1, (end() - p - 1) * sizeof(T));
+        n -= 1;
+
+        return p;
+    }
+
+    std::size_t erase(const T &x) {
+        if (iterator it = find(x); it != end()) {
+            erase(it);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    void clear() {
+        n = 0;
+    }
+};
+
+#endif
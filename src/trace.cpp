@@ -0,0 +1,238 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "trace.h"
+
+// The trace is written in the JSON array form of the format, which
+// viewers accept even if the closing bracket is missing, so that the
+// traces of interrupted evaluations are still usable.
+
+static std::mutex trace_mutex;
+static std::filebuf trace_filebuf;
+static std::ostream trace_stream(nullptr);
+static Trace_clock::time_point trace_start;
+static bool trace_open, trace_first;
+static std::atomic<bool> trace_enabled;
+static thread_local int current_track;
+
+static std::string quote(const std::string &s)
+{
+    std::string r("\"");
+
+    for (const char c: s) {
+        switch (c) {
+        case '"': r += "\\\""; break;
+        case '\\': r += "\\\\"; break;
+        case '\n': r += "\\n"; break;
+        case '\t': r += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char b[8];
+
+                std::snprintf(b, sizeof(b), "\\u%04x", c);
+                r += b;
+            } else {
+                r += c;
+            }
+        }
+    }
+
+    return r + "\"";
+}
+
+static double timestamp(Trace_clock::time_point t)
+{
+    return std::chrono::duration<double, std::micro>(t - trace_start).count();
+}
+
+// Write out a complete event.  Events are formed outside the lock.
+
+static void write_event(const std::string &s)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    if (!trace_open) {
+        return;
+    }
+
+    trace_stream << (trace_first ? "[\n" : ",\n") << s;
+    trace_first = false;
+}
+
+bool open_trace(const char *filename)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    if (trace_open) {
+        return false;
+    }
+
+    if (!std::strcmp(filename, "-")) {
+        trace_stream.rdbuf(std::cout.rdbuf());
+    } else if (trace_filebuf.open(filename, std::ios::out)) {
+        trace_stream.rdbuf(&trace_filebuf);
+    } else {
+        return false;
+    }
+
+    trace_stream.setf(std::ios::fixed);
+    trace_stream.precision(3);
+    trace_start = Trace_clock::now();
+    trace_open = trace_first = true;
+    trace_enabled = true;
+    current_track = 0;
+
+    return true;
+}
+
+void close_trace()
+{
+    trace_enabled = false;
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    if (!trace_open) {
+        return;
+    }
+
+    trace_stream << (trace_first ? "[]\n" : "\n]\n") << std::flush;
+    trace_stream.rdbuf(nullptr);
+    trace_filebuf.close();
+    trace_open = false;
+}
+
+void abandon_trace()
+{
+    trace_enabled = false;
+    trace_open = false;
+}
+
+bool tracing()
+{
+    return trace_enabled.load(std::memory_order_relaxed);
+}
+
+void trace_track(int track, const std::string &name)
+{
+    if (!tracing()) {
+        return;
+    }
+
+    std::ostringstream s;
+
+    s << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << track
+      << ",\"args\":{\"name\":" << quote(name) << "}}";
+
+    write_event(s.str());
+}
+
+void trace_thread(int track, const std::string &name)
+{
+    current_track = track;
+    trace_track(track, name);
+}
+
+int current_trace_track()
+{
+    return current_track;
+}
+
+void trace_span(const char *category, const std::string &name,
+                Trace_clock::time_point t_0, Trace_clock::time_point t_1,
+                const std::unordered_map<std::string, std::string> &args)
+{
+    trace_span(current_track, category, name, t_0, t_1, args);
+}
+
+void trace_span(int track, const char *category, const std::string &name,
+                Trace_clock::time_point t_0, Trace_clock::time_point t_1,
+                const std::unordered_map<std::string, std::string> &args)
+{
+    if (!tracing()) {
+        return;
+    }
+
+    std::ostringstream s;
+
+    s.setf(std::ios::fixed);
+    s.precision(3);
+    s << "{\"ph\":\"X\",\"cat\":\"" << category << "\",\"name\":" << quote(name)
+      << ",\"pid\":1,\"tid\":" << track
+      << ",\"ts\":" << timestamp(t_0)
+      << ",\"dur\":" << timestamp(t_1) - timestamp(t_0);
+
+    if (!args.empty()) {
+        const char *c = "{";
+
+        s << ",\"args\":";
+
+        for (const auto &[k, v]: args) {
+            s << c << quote(k) << ":" << quote(v);
+            c = ",";
+        }
+
+        s << "}";
+    }
+
+    s << "}";
+
+    write_event(s.str());
+}
+
+void trace_flow(int track, bool start, const std::string &id,
+                Trace_clock::time_point t)
+{
+    if (!tracing()) {
+        return;
+    }
+
+    std::ostringstream s;
+
+    s.setf(std::ios::fixed);
+    s.precision(3);
+    s << "{\"ph\":\"" << (start ? 's' : 'f')
+      << "\",\"bp\":\"e\",\"cat\":\"flow\",\"name\":\"operand\",\"id\":"
+      << quote(id) << ",\"pid\":1,\"tid\":" << track
+      << ",\"ts\":" << timestamp(t) << "}";
+
+    write_event(s.str());
+}
+
+void trace_counter(const char *name, double value)
+{
+    if (!tracing()) {
+        return;
+    }
+
+    std::ostringstream s;
+
+    s.setf(std::ios::fixed);
+    s.precision(3);
+    s << "{\"ph\":\"C\",\"name\":\"" << name << "\",\"pid\":1"
+      << ",\"ts\":" << timestamp(Trace_clock::now())
+      << ",\"args\":{\"value\":" << value << "}}";
+
+    write_event(s.str());
+}
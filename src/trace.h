@@ -0,0 +1,78 @@
+// Copyright 2022 Dimitris Papavasiliou
+
+// This file is part of Gamma.
+
+// Gamma is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+// Evaluation can be traced, producing a timeline in the trace event
+// format, which can be viewed in standard trace viewers, such as
+// Perfetto.  The timeline has a track per thread of evaluation,
+// containing spans for operations and their phases, with flows
+// linking each operation to its successors, as well as counters.
+// Events are only recorded while a trace is open, which is only the
+// case during evaluation.
+
+typedef std::chrono::steady_clock Trace_clock;
+
+// Open a trace file, or the standard output if the filename is "-",
+// and close it, once evaluation has concluded.  Only one trace can
+// be open at a time.
+
+bool open_trace(const char *filename);
+void close_trace();
+
+// Stop tracing without closing the trace, e.g. in a forked child
+// process, which mustn't write to the parent's trace.
+
+void abandon_trace();
+
+bool tracing();
+
+// Name a track and make it the track of the calling thread.  Track 0
+// is the main thread's.
+
+void trace_track(int track, const std::string &name);
+void trace_thread(int track, const std::string &name);
+int current_trace_track();
+
+// Record a span of the calling thread's track, or of another track.
+// Spans of a track can be nested, but must not otherwise overlap.
+
+void trace_span(const char *category, const std::string &name,
+                Trace_clock::time_point t_0, Trace_clock::time_point t_1,
+                const std::unordered_map<std::string, std::string> &args = {});
+
+void trace_span(int track, const char *category, const std::string &name,
+                Trace_clock::time_point t_0, Trace_clock::time_point t_1,
+                const std::unordered_map<std::string, std::string> &args = {});
+
+// Record the start, or end of a flow, tying it to the span enclosing
+// the given point in time on the given track.  Both ends of a flow
+// are identified by the same id.
+
+void trace_flow(int track, bool start, const std::string &id,
+                Trace_clock::time_point t);
+
+// Record the value of a counter.
+
+void trace_counter(const char *name, double value);
+
+#endif
@@ -88,7 +88,7 @@ Aff_transformation_3 axis_angle_rotation(const double theta, const double *axis)
 // Transformation tag composition
 
 template<typename A>
-static bool compose_simple(std::ostringstream &s, const A &T)
+static bool compose_simple(std::string &s, const A &T)
 {
     constexpr int n = CGAL::Ambient_dimension<A, Kernel>::value;
     bool p = true;
@@ -106,10 +106,10 @@ static bool compose_simple(std::ostringstream &s, const A &T)
     }
 
     if (p) {
-        s << "translation(";
+        s += "translation(";
 
         for (int i = 0; i < n; i++) {
-            s << T.m(i, n).exact() << ",";
+            compose_tag_helper<FT>::compose(s, T.m(i, n));
         }
     } else {
         for (int i = 0; i < n; i++) {
@@ -118,20 +118,21 @@ static bool compose_simple(std::ostringstream &s, const A &T)
             }
         }
 
-        s << "scaling(";
+        s += "scaling(";
 
         for (int i = 0; i < n; i++) {
-            s << T.m(i, i).exact() << ",";
+            compose_tag_helper<FT>::compose(s, T.m(i, i));
         }
     }
 
-    s.seekp(-1, std::ios_base::end) << "),";
+    s.back() = ')';
+    s += ',';
 
     return true;
 }
 
 template<typename A>
-static bool compose_linear(std::ostringstream &s, const A &T)
+static bool compose_linear(std::string &s, const A &T)
 {
     constexpr int n = CGAL::Ambient_dimension<A, Kernel>::value;
 
@@ -183,42 +184,45 @@ static bool compose_linear(std::ostringstream &s, const A &T)
     // Print the "rotation part" only.
 
   print_matrix:
-    s << x << "(";
+    s += x;
+    s += '(';
 
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
-            s << T.m(i, j).exact() << ",";
+            compose_tag_helper<FT>::compose(s, T.m(i, j));
         }
     }
 
-    s.seekp(-1, std::ios_base::end) << "),";
+    s.back() = ')';
+    s += ',';
 
     return true;
 }
 
 template<typename A>
-static bool compose_affine(std::ostringstream &s, const A &T)
+static bool compose_affine(std::string &s, const A &T)
 {
     constexpr int n = CGAL::Ambient_dimension<A, Kernel>::value;
 
-    s << "transformation(";
+    s += "transformation(";
 
     // Print the full matrix.
 
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n + 1; j++) {
-            s << T.m(i, j).exact() << ",";
+            compose_tag_helper<FT>::compose(s, T.m(i, j));
         }
     }
 
-    s.seekp(-1, std::ios_base::end) << "),";
+    s.back() = ')';
+    s += ',';
 
     return true;
 }
 
 template<>
 void compose_tag_helper<Aff_transformation_2>::compose(
-    std::ostringstream &s, const Aff_transformation_2 &T)
+    std::string &s, const Aff_transformation_2 &T)
 {
     compose_simple(s, T)
         || compose_linear(s, T)
@@ -227,7 +231,7 @@ void compose_tag_helper<Aff_transformation_2>::compose(
 
 template<>
 void compose_tag_helper<Aff_transformation_3>::compose(
-    std::ostringstream &s, const Aff_transformation_3 &T)
+    std::string &s, const Aff_transformation_3 &T)
 {
     compose_simple(s, T)
         || compose_linear(s, T)
@@ -21,6 +21,9 @@
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/data/monomorphic.hpp>
 
+#include <sstream>
+
+#include "options.h"
 #include "kernel.h"
 #include "transformations.h"
 #include "macros.h"
@@ -331,4 +334,28 @@ BOOST_AUTO_TEST_CASE(
     test_polygon_area(*b->get_value(), 8);
 }
 
+// Test parallel evaluation of circle polygon operations.
+
+BOOST_FIXTURE_TEST_CASE(threads, Threads_guard)
+{
+    std::vector<std::shared_ptr<Polygon_operation<Circle_polygon_set>>> v;
+
+    for (int i = 0; i < 16; i++) {
+        v.push_back(
+            JOIN(
+                TRANSFORM_CS(CIRCLE(1), TRANSLATION_2(i, 1)),
+                JOIN(
+                    TRANSFORM_CS(CIRCLE(1), TRANSLATION_2(i, -1)),
+                    CONVERT_TO<Circle_polygon_set>(
+                        TRANSFORM(RECTANGLE(2, 2), TRANSLATION_2(i, 0))))));
+    }
+
+    evaluate_unit();
+
+    for (const auto &p: v) {
+        BOOST_TEST(p->threadsafe);
+        test_polygon(*p->get_value(), "CLCL");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -21,8 +21,11 @@
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/data/monomorphic.hpp>
 
+#include <sstream>
+
 #include <CGAL/draw_polygon_set_2.h>
 
+#include "options.h"
 #include "kernel.h"
 #include "transformations.h"
 #include "macros.h"
@@ -348,4 +351,30 @@ BOOST_DATA_TEST_CASE(convert_elliptic_sector,
     test_polygon_area(*b->get_value(), std::acos(-1) * (4 * i + 1));
 }
 
+// Test evaluation of conic polygon operations alongside other
+// operations evaluated in parallel.  Operations producing, or
+// consuming, conic polygon sets should be confined to the main
+// thread.
+
+BOOST_FIXTURE_TEST_CASE(threads, Threads_guard,
+                        * boost::unit_test::tolerance(0.001))
+{
+    Tolerances::curve = FT::ET(1, 1000);
+
+    auto a = TRANSFORM(RECTANGLE(4, 4), TRANSLATION_2(2, 0));
+    auto b = JOIN(a, ELLIPSE(4, 2));
+    auto c = CONVERT_TO<Polygon_set>(b);
+    auto d = JOIN(c, TRANSFORM(RECTANGLE(2, 2), TRANSLATION_2(0, 4)));
+
+    evaluate_unit();
+
+    BOOST_TEST(a->threadsafe);
+    BOOST_TEST(!b->threadsafe);
+    BOOST_TEST(!c->threadsafe);
+    BOOST_TEST(d->threadsafe);
+
+    test_polygon(*b->get_value(), "EELLL");
+    test_polygon_area(*d->get_value(), CGAL::to_double(polygon_area(*c->get_value())) + 4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
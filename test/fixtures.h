@@ -28,4 +28,19 @@ struct Reset_operations {
     }
 };
 
+// Evaluate on several worker threads, restoring the number of
+// threads once the test case is done, whatever its outcome.
+
+struct Threads_guard: public Reset_operations {
+    const int saved_threads;
+
+    Threads_guard(): saved_threads(Options::threads) {
+        Options::threads = 4;
+    }
+
+    ~Threads_guard() {
+        Options::threads = saved_threads;
+    }
+};
+
 #endif
@@ -1414,6 +1414,16 @@ EXPECTING("write_off(\"foo.off\",mesh(tetrahedron(1,1,1)))",
           "pipe(mesh(tetrahedron(1,1,1)))",
           "pipe(mesh(tetrahedron(1,1,1)),mesh(tetrahedron(-1,1,1)))")
 
+DEFINE_TEST_CASE(pin)
+WITH_LUA_SOURCE("g = require 'gamma.polygons'"
+                "h = require 'gamma.polyhedra'"
+
+                "P, Q = pin(g.rectangle(2, 2), h.tetrahedron(1, 1, 1))")
+WITH_SCHEME_SOURCE("(import (gamma polygons) (gamma polyhedra))"
+                   "(pin (rectangle 2 2) (tetrahedron 1 1 1))")
+EXPECTING(RECTANGLE_TAG,
+          "tetrahedron(1,1,1)")
+
 #undef DEFINE_TEST_CASE
 #undef WITH_LUA_SOURCE
 #undef WITH_SCHEME_SOURCE
@@ -20,11 +20,18 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
 #include <CGAL/assertions.h>
 
 #include "options.h"
 #include "kernel.h"
+#include "cost_database.h"
+#include "digest.h"
 #include "transformations.h"
 #include "tolerances.h"
 #include "projection.h"
@@ -40,6 +47,9 @@ struct Global_fixture {
       Flags::eliminate_dead_operations = 0;
       Flags::store_operations = 0;
       Flags::load_operations = 0;
+      Flags::release_operations = 0;
+      Options::cost_database = nullptr;
+      Options::threads = 0;
 
       parse_options(
           boost::unit_test::framework::master_test_suite().argc,
@@ -70,21 +80,27 @@ BOOST_AUTO_TEST_SUITE(options)
 BOOST_AUTO_TEST_CASE(dump)
 {
     const char *s = Options::dump_operations, *t = Options::dump_graph;
+    const char *u = Options::dump_trace;
 
     BOOST_TEST(
-        test_options({"test", "--dump-operations", "--dump-graph"}) == 3);
+        test_options({"test", "--dump-operations", "--dump-graph",
+                      "--dump-trace=test.json"}) == 4);
 
     BOOST_TEST(Options::dump_operations);
     BOOST_TEST(Options::dump_graph);
+    BOOST_TEST(!std::strcmp(Options::dump_trace, "test.json"));
 
     BOOST_TEST(
-        test_options({"test", "--no-dump-operations", "--no-dump-graph"}) == 3);
+        test_options({"test", "--no-dump-operations", "--no-dump-graph",
+                      "--no-dump-trace"}) == 4);
 
     BOOST_TEST(!Options::dump_operations);
     BOOST_TEST(!Options::dump_graph);
+    BOOST_TEST(!Options::dump_trace);
 
     Options::dump_operations = s;
     Options::dump_graph = t;
+    Options::dump_trace = u;
 }
 
 BOOST_AUTO_TEST_CASE(dump_short_tags)
@@ -191,6 +207,133 @@ BOOST_AUTO_TEST_CASE(store_threshold)
     Options::store_threshold = i;
 }
 
+BOOST_AUTO_TEST_CASE(io_threads)
+{
+    int i = Options::io_threads;
+
+    BOOST_TEST(
+        test_options({"test", "--io-threads=4"}) == 2);
+
+    BOOST_TEST(Options::io_threads == 4);
+
+    BOOST_TEST(
+        test_options({"test", "--no-io-threads"}) == 2);
+
+    BOOST_TEST(Options::io_threads == 0);
+
+    BOOST_TEST(
+        test_options({"test", "--io-threads"}) == -EXIT_FAILURE);
+
+    BOOST_TEST(
+        test_options({"test", "--io-threads=-1"}) == -EXIT_FAILURE);
+
+    Options::io_threads = i;
+}
+
+BOOST_AUTO_TEST_CASE(processes)
+{
+    int i = Options::processes;
+
+    BOOST_TEST(
+        test_options({"test", "--processes=4"}) == 2);
+
+    BOOST_TEST(Options::processes == 4);
+
+    BOOST_TEST(
+        test_options({"test", "--no-processes"}) == 2);
+
+    BOOST_TEST(Options::processes == 0);
+
+    BOOST_TEST(
+        test_options({"test", "--processes=-1"}) == -EXIT_FAILURE);
+
+    Options::processes = i;
+}
+
+BOOST_AUTO_TEST_CASE(cache_limit)
+{
+    int i = Options::cache_limit;
+
+    BOOST_TEST(
+        test_options({"test", "--cache-limit=512"}) == 2);
+
+    BOOST_TEST(Options::cache_limit == 512);
+
+    BOOST_TEST(
+        test_options({"test", "--no-cache-limit"}) == 2);
+
+    BOOST_TEST(Options::cache_limit == -1);
+
+    BOOST_TEST(
+        test_options({"test", "--cache-limit"}) == -EXIT_FAILURE);
+
+    BOOST_TEST(
+        test_options({"test", "--cache-limit=-1"}) == -EXIT_FAILURE);
+
+    Options::cache_limit = i;
+}
+
+BOOST_AUTO_TEST_CASE(cost_database)
+{
+    const char *s = Options::cost_database;
+
+    BOOST_TEST(
+        test_options({"test", "--cost-database=foo"}) == 2);
+
+    BOOST_TEST(Options::cost_database);
+    BOOST_TEST(!std::strcmp(Options::cost_database, "foo"));
+
+    BOOST_TEST(
+        test_options({"test", "--no-cost-database"}) == 2);
+
+    BOOST_TEST(!Options::cost_database);
+
+    BOOST_TEST(
+        test_options({"test", "--cost-database"}) == -EXIT_FAILURE);
+
+    Options::cost_database = s;
+}
+
+BOOST_AUTO_TEST_CASE(cost_database_limit)
+{
+    int i = Options::cost_database_limit;
+
+    BOOST_TEST(
+        test_options({"test", "--cost-database-limit=10"}) == 2);
+
+    BOOST_TEST(Options::cost_database_limit == 10);
+
+    BOOST_TEST(
+        test_options({"test", "--no-cost-database-limit"}) == 2);
+
+    BOOST_TEST(Options::cost_database_limit == -1);
+
+    BOOST_TEST(
+        test_options({"test", "--cost-database-limit=-1"}) == -EXIT_FAILURE);
+
+    Options::cost_database_limit = i;
+}
+
+BOOST_AUTO_TEST_CASE(store_directory)
+{
+    const char *s = Options::store_directory;
+
+    Options::store_directory = nullptr;
+    BOOST_TEST(store_file_path("gamma.costs") == "gamma.costs");
+
+    BOOST_TEST(
+        test_options({"test", "--store-directory=foo"}) == 2);
+
+    BOOST_TEST(
+        store_file_path("gamma.costs")
+        == (std::filesystem::path("foo") / "gamma.costs").string());
+
+    BOOST_TEST(
+        test_options({"test", "--store-directory"}) == -EXIT_FAILURE);
+
+    Options::store_directory = s;
+}
+
 BOOST_AUTO_TEST_CASE(rewrite_pass_limit)
 {
     int i = Options::rewrite_pass_limit;
@@ -348,12 +491,18 @@ BOOST_AUTO_TEST_CASE(flags)
 
     TEST_FLAG(dump-abridged-tags, dump_abridged_tags);
     TEST_FLAG(dump-annotations, dump_annotations);
+    TEST_FLAG(count-events, count_events);
+    TEST_FLAG(estimate, estimate);
     TEST_FLAG(fold-transformations, fold_transformations);
     TEST_FLAG(fold-booleans, fold_booleans);
     TEST_FLAG(fold-flushes, fold_flushes);
     TEST_FLAG(eliminate-dead-operations, eliminate_dead_operations);
     TEST_FLAG(store-operations, store_operations);
     TEST_FLAG(load-operations, load_operations);
+    TEST_FLAG(release-operations, release_operations);
+    TEST_FLAG(share-operations, share_operations);
+    TEST_FLAG(combine-units, combine_units);
+    TEST_FLAG(watch, watch);
     TEST_FLAG(stl, output_stl);
     TEST_FLAG(output-stl, output_stl);
     TEST_FLAG(off, output_off);
@@ -462,6 +611,531 @@ BOOST_AUTO_TEST_CASE(evaluation)
     evaluate_unit();
 }
 
+// Test prioritization.  Operations should always be given higher
+// priority than the operations that depend on them.
+
+BOOST_AUTO_TEST_CASE(priorities)
+{
+    auto a = TETRAHEDRON(1, 1, 1);
+    auto b = CONVERT_TO<Surface_mesh>(a);
+    auto c = WRITE_OFF("test.out", {b});
+    auto d = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, -1));
+
+    evaluate_unit();
+
+    BOOST_TEST(a->priority > b->priority);
+    BOOST_TEST(b->priority > c->priority);
+    BOOST_TEST(c->priority > 0);
+    BOOST_TEST(d->priority > 0);
+}
+
+// Test recording of operation costs.  The database should only be
+// written when storing operations and should be pruned down to its
+// limit.
+
+BOOST_AUTO_TEST_CASE(costs)
+{
+    const char *s = Options::cost_database;
+    const int i = Options::store_threshold;
+    const int j = Options::cost_database_limit;
+    const int b = Flags::store_operations;
+
+    Options::cost_database = "test.costs";
+
+    auto p = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+
+    evaluate_unit();
+    BOOST_TEST(!std::filesystem::exists("test.costs"));
+
+    // Store, but set the threshold so that nothing is actually
+    // stored.
+
+    begin_unit("test_case");
+    Flags::store_operations = 1;
+    Options::store_threshold = std::numeric_limits<int>::max();
+
+    p = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+
+    evaluate_unit();
+
+    const Operation_costs c = find_operation_costs(p->digest());
+
+    BOOST_TEST(c.evaluation_time >= 0);
+    BOOST_TEST(c.load_time < 0);
+    BOOST_TEST(c.size > 0);
+    BOOST_TEST(c.memory > 0);
+    BOOST_TEST(p->annotations.count("size"));
+    BOOST_TEST(p->annotations.count("memory"));
+
+    {
+        std::ifstream f("test.costs");
+        std::string k;
+        bool found = false;
+
+        while (f >> k) {
+            found = found || k == p->digest();
+        }
+
+        BOOST_TEST(found);
+    }
+
+    // Record the costs of a new operation and make sure the database
+    // is pruned down to a single entry.
+
+    begin_unit("test_case");
+    Options::cost_database_limit = 1;
+
+    auto q = CONVERT_TO<Surface_mesh>(TETRAHEDRON(2, 2, 2));
+
+    evaluate_unit();
+
+    {
+        std::ifstream f("test.costs");
+        std::string l;
+        int n = 0;
+
+        while (std::getline(f, l)) {
+            n++;
+        }
+
+        BOOST_TEST(n == 1);
+    }
+
+    std::filesystem::remove("test.costs");
+    Options::cost_database = s;
+    Options::store_threshold = i;
+    Options::cost_database_limit = j;
+    Flags::store_operations = b;
+}
+
+// Test estimation of evaluation costs.  Operations should not be
+// evaluated, but their recorded costs should be reported.
+
+BOOST_AUTO_TEST_CASE(estimate)
+{
+    const int f = Flags::estimate;
+
+    auto a = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+    evaluate_unit();
+
+    const Operation_costs c = find_operation_costs(a->digest());
+
+    BOOST_TEST(c.evaluation_time >= 0);
+    BOOST_TEST(c.kind == "mesh");
+
+    begin_unit("test_case");
+    Flags::estimate = 1;
+
+    auto b = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+
+    std::ostringstream s;
+    auto r = std::cout.rdbuf(s.rdbuf());
+
+    evaluate_unit();
+    std::cout.rdbuf(r);
+
+    BOOST_TEST(b->size() == 0);
+    BOOST_TEST(s.str().find("Estimated evaluation of 2 operations")
+               != std::string::npos);
+    BOOST_TEST(s.str().find("2 recorded") != std::string::npos);
+
+    Flags::estimate = f;
+}
+
+// Test releasing of intermediate results.  Operations should be
+// released once consumed, unless they feed a sink or are pinned.
+
+BOOST_AUTO_TEST_CASE(release)
+{
+    const int f = Flags::release_operations;
+    Flags::release_operations = 1;
+
+    auto a = TETRAHEDRON(1, 1, 1);
+    auto b = CONVERT_TO<Surface_mesh>(a);
+    auto c = WRITE_OFF("test.out", {b});
+    auto d = TETRAHEDRON(1, 1, -1);
+    auto e = CONVERT_TO<Surface_mesh>(d);
+
+    d->pinned = true;
+
+    evaluate_unit();
+
+    BOOST_TEST(a->size() == 0);
+    BOOST_TEST(b->size() > 0);
+    BOOST_TEST(d->size() > 0);
+    BOOST_TEST(e->size() > 0);
+
+    Flags::release_operations = f;
+}
+
+// Test taking of operation results.  Ownership should only be
+// transferred to the last consumer of a disposable result.
+
+BOOST_AUTO_TEST_CASE(take)
+{
+    auto a = TETRAHEDRON(1, 1, 1);
+
+    a->pinned = true;
+    evaluate_unit();
+
+    const Polyhedron *p = a->get_value().get();
+
+    a->disposable = true;
+    a->consumers = 2;
+    BOOST_TEST(a->take_value().get() != p);
+    BOOST_TEST(a->get_value().get() == p);
+
+    a->consumers = 1;
+    BOOST_TEST(a->take_value().get() == p);
+    BOOST_TEST(a->size() == 0);
+}
+
+// Test retaining of results across units, in watch mode.  Identical
+// operations should adopt retained results, instead of being
+// evaluated, while results not referenced by the last unit should be
+// evicted, once over the limit.
+
+BOOST_AUTO_TEST_CASE(watch)
+{
+    const int f = Flags::watch, n = Options::cache_limit;
+    Flags::watch = 1;
+
+    auto a = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+    evaluate_unit();
+
+    begin_unit("test_case");
+    auto b = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+    auto c = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, -1));
+    evaluate_unit();
+
+    BOOST_TEST(b->cached);
+    BOOST_TEST(b->get_value() == a->get_value());
+    BOOST_TEST(!c->cached);
+
+    Options::cache_limit = 0;
+
+    begin_unit("test_case");
+    auto d = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, -1));
+    evaluate_unit();
+
+    BOOST_TEST(d->cached);
+
+    begin_unit("test_case");
+    auto e = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+    evaluate_unit();
+
+    BOOST_TEST(!e->cached);
+
+    // The source files the operations were instantiated in, as
+    // annotated by the frontend, should be reported, so that they can
+    // be watched as well.
+
+    begin_unit("test_case");
+    auto g = TETRAHEDRON(3, 3, 3);
+    auto h = TETRAHEDRON(4, 4, 4);
+    auto k = TETRAHEDRON(5, 5, 5);
+
+    g->annotations.insert({"file", "foo.lua"});
+    h->annotations.insert({"file", "bar.lua"});
+    k->annotations.insert({"file", "foo.lua"});
+
+    BOOST_TEST(
+        (unit_files() == std::vector<std::string>{"bar.lua", "foo.lua"}));
+
+    discard_unit();
+
+    Flags::watch = f;
+    Options::cache_limit = n;
+}
+
+// Test sharing of operations across units.  Identical operations in
+// subsequent units should reuse the earlier result, without loading
+// it, even when it's an intermediate result.
+
+BOOST_AUTO_TEST_CASE(share)
+{
+    const int f = Flags::share_operations, g = Flags::release_operations;
+    Flags::share_operations = 1;
+    Flags::release_operations = 1;
+
+    auto a = TETRAHEDRON(2, 2, 2);
+    CONVERT_TO<Surface_mesh>(a);
+    evaluate_unit();
+
+    begin_unit("test_case");
+    auto b = TETRAHEDRON(2, 2, 2);
+    evaluate_unit();
+
+    BOOST_TEST(b->cached);
+    BOOST_TEST(b->get_value() == a->get_value());
+    BOOST_TEST(b->annotations.count("loaded") == 0);
+
+    Flags::share_operations = f;
+    Flags::release_operations = g;
+}
+
+// Test cancellation.  Once evaluation has been cancelled, operations
+// should fail, without being evaluated.
+
+BOOST_AUTO_TEST_CASE(cancellation)
+{
+    auto a = TETRAHEDRON(1, 1, 1);
+    const std::atomic<bool> c(true);
+
+    Operation::cancellation = &c;
+    BOOST_CHECK_THROW(a->dispatch(), operation_cancelled);
+    Operation::cancellation = nullptr;
+
+    BOOST_TEST(a->size() == 0);
+}
+
+// Test combined evaluation of units.  The operations of each unit
+// should be evaluated separately, but together, with separate dumps.
+
+BOOST_AUTO_TEST_CASE(combine_units)
+{
+    const int f = Flags::combine_units;
+    const char *s = Options::dump_operations;
+
+    Flags::combine_units = 1;
+    Options::dump_operations = "";
+
+    auto a = TETRAHEDRON(1, 1, 1);
+
+    begin_unit("test_case_2");
+    auto b = TETRAHEDRON(1, 1, 1);
+
+    evaluate_unit();
+
+    BOOST_TEST(a != b);
+    BOOST_TEST(a->size() > 0);
+    BOOST_TEST(b->size() > 0);
+
+    for (const char *t: {"test_case.list", "test_case_2.list"}) {
+        BOOST_TEST(std::filesystem::file_size(t) > 0);
+        std::filesystem::remove(t);
+    }
+
+    Flags::combine_units = f;
+    Options::dump_operations = s;
+}
+
+// Test evaluation of thread-unsafe operations in child processes.
+// The conversion of the conic polygon set should be evaluated in a
+// child and its result transferred back, while the conic operations
+// can't be, as conics can't be stored (and are instead evaluated
+// anew in the child).
+
+BOOST_AUTO_TEST_CASE(processes)
+{
+    const int n = Options::processes;
+    std::shared_ptr<Polygon_operation<Polygon_set>> v[2];
+
+    for (int k = 0; k < 2; k++) {
+        begin_unit("test_case");
+        Options::processes = 2 * k;
+
+        auto a = JOIN(RECTANGLE(2, 2), ELLIPSE(2, 1));
+        v[k] = CONVERT_TO<Polygon_set>(a);
+
+        evaluate_unit();
+
+        BOOST_TEST(a->annotations.count("process") == 0);
+    }
+
+    BOOST_TEST(v[0]->annotations.count("process") == 0);
+    BOOST_TEST(v[1]->annotations.count("process") > 0);
+
+    const auto &A = v[0]->get_value()->arrangement();
+    const auto &B = v[1]->get_value()->arrangement();
+
+    BOOST_TEST(A.number_of_vertices() == B.number_of_vertices());
+    BOOST_TEST(A.number_of_edges() == B.number_of_edges());
+
+    // Structurally identical operations of combined units may be
+    // evaluated concurrently, but mustn't clobber each other's
+    // results.
+
+    const int f = Flags::combine_units;
+    Flags::combine_units = 1;
+    Options::processes = 2;
+
+    begin_unit("test_case");
+    auto b = CONVERT_TO<Polygon_set>(JOIN(RECTANGLE(2, 2), ELLIPSE(2, 1)));
+    begin_unit("test_case_2");
+    auto c = CONVERT_TO<Polygon_set>(JOIN(RECTANGLE(2, 2), ELLIPSE(2, 1)));
+
+    evaluate_unit();
+
+    for (const auto &x: {b, c}) {
+        BOOST_TEST(x->annotations.count("process") > 0);
+        BOOST_TEST(x->get_value()->arrangement().number_of_vertices()
+                   == A.number_of_vertices());
+    }
+
+    Flags::combine_units = f;
+    Options::processes = n;
+}
+
+// Test tracing of evaluation.  The trace should contain a span for
+// each operation, tied to its operands by flows, along with the
+// tracks of the threads and counters.
+
+BOOST_AUTO_TEST_CASE(trace)
+{
+    const int n = Options::threads;
+    const char *s = Options::dump_trace;
+
+    Options::threads = 2;
+    Options::dump_trace = "test.json";
+
+    JOIN(TETRAHEDRON(1, 1, 1), TETRAHEDRON(1, 1, -1));
+    evaluate_unit();
+
+    std::ifstream f("test.json");
+    const std::string t((std::istreambuf_iterator<char>(f)),
+                        std::istreambuf_iterator<char>());
+
+    BOOST_TEST(t.front() == '[');
+    BOOST_TEST(t.substr(t.size() - 2) == "]\n");
+
+    for (const char *x: {"\"ph\":\"X\",\"cat\":\"operation\"",
+                         "\"ph\":\"X\",\"cat\":\"evaluate\"",
+                         "\"ph\":\"s\"", "\"ph\":\"f\"", "\"ph\":\"C\"",
+                         "\"name\":\"worker 0\""}) {
+        BOOST_TEST(t.find(x) != std::string::npos, x);
+    }
+
+    std::filesystem::remove("test.json");
+
+    Options::threads = n;
+    Options::dump_trace = s;
+}
+
+// Test counting of hardware events.  Counters may not be available,
+// or permitted, but those that are, should only be annotated when
+// requested.
+
+BOOST_AUTO_TEST_CASE(counters)
+{
+    const int f = Flags::count_events;
+    const char *events[] = {"cycles", "instructions", "cache-misses",
+                            "branch-misses", "page-faults"};
+
+    Flags::count_events = 0;
+
+    auto a = TETRAHEDRON(1, 1, 1);
+    evaluate_unit();
+
+    for (const char *x: events) {
+        BOOST_TEST(!a->annotations.count(x), x);
+    }
+
+    Flags::count_events = 1;
+
+    auto b = TETRAHEDRON(1, 1, -1);
+    evaluate_unit();
+
+    for (const char *x: events) {
+        auto it = b->annotations.find(x);
+
+        if (it != b->annotations.end()) {
+            BOOST_TEST(it->second.find_first_not_of("0123456789")
+                       == std::string::npos, x);
+        }
+    }
+
+    Flags::count_events = f;
+}
+
+// Stress test parallel evaluation, preferably under ThreadSanitizer.
+// A graph of thread-safe and unsafe operations, with widely shared
+// operands, is evaluated with all dumps enabled and its results
+// compared to those of serial evaluation.
+
+BOOST_AUTO_TEST_CASE(threads)
+{
+    const int n = Options::threads, f = Flags::dump_abridged_tags;
+    const char *s[] = {
+        Options::dump_operations, Options::dump_log, Options::dump_graph};
+
+    std::vector<std::shared_ptr<Polyhedron_operation<Polyhedron>>> v[2];
+
+    Options::dump_operations = "test.list";
+    Options::dump_log = "test.log";
+    Options::dump_graph = "test.dot";
+    Flags::dump_abridged_tags = 1;
+
+    for (int k = 0; k < 2; k++) {
+        std::shared_ptr<Polyhedron_operation<Polyhedron>> p;
+
+        begin_unit("test_case");
+        Options::threads = 8 * k;
+
+        for (int i = 0; i < 16; i++) {
+            auto a = TRANSFORM(RECTANGLE(2, 2), TRANSLATION_2(i, 0));
+            auto b = EXTRUSION(
+                a, {TRANSLATION_3(0, 0, 0), TRANSLATION_3(0, 0, 1 + i % 3)});
+            auto c = EXTRUSION(
+                CONVERT_TO<Polygon_set>(JOIN(a, ELLIPSE(2, 1))),
+                {TRANSLATION_3(0, 0, 0), TRANSLATION_3(0, 0, 1)});
+
+            v[k].push_back(c);
+            v[k].push_back(b);
+
+            if (p) {
+                v[k].push_back(JOIN(p, b));
+            }
+
+            p = b;
+        }
+
+        evaluate_unit();
+    }
+
+    BOOST_TEST_REQUIRE(v[0].size() == v[1].size());
+
+    for (std::size_t i = 0; i < v[0].size(); i++) {
+        BOOST_TEST(v[0][i]->get_value()->size_of_vertices()
+                   == v[1][i]->get_value()->size_of_vertices());
+        BOOST_TEST(v[0][i]->get_value()->size_of_facets()
+                   == v[1][i]->get_value()->size_of_facets());
+    }
+
+    for (const char *x: {"test.list", "test.log", "test.dot"}) {
+        std::filesystem::remove(x);
+    }
+
+    Options::dump_operations = s[0];
+    Options::dump_log = s[1];
+    Options::dump_graph = s[2];
+    Flags::dump_abridged_tags = f;
+    Options::threads = n;
+}
+
+// Test evaluation of a long chain of operations, which shouldn't
+// exhaust the stack while it's walked.
+
+BOOST_AUTO_TEST_CASE(deep_graph)
+{
+    const int f = Flags::fold_transformations;
+
+    Flags::fold_transformations = 0;
+    begin_unit("test_case");
+
+    auto p = RECTANGLE(2, 2);
+
+    for (int i = 0; i < 100000; i++) {
+        p = TRANSFORM(p, TRANSLATION_2(i % 2 == 0 ? 1 : -1, 0));
+    }
+
+    evaluate_unit();
+
+    BOOST_TEST(p->get_value()->arrangement().number_of_vertices() == 4);
+
+    Flags::fold_transformations = f;
+}
+
 // Test evaluation failure.  With -Wfatal-errors and a single
 // evaluation thread, b should never be evaluated and this should
 // fail.
@@ -506,10 +1180,78 @@ BOOST_AUTO_TEST_CASE(simple_duplicate)
     BOOST_TEST(q != r);
 }
 
+// Only the most recent allocation can be reclaimed from an arena,
+// while operations allocated from the arena of a unit should outlive
+// it, if referenced.
+
+BOOST_AUTO_TEST_CASE(arena)
+{
+    Arena a;
+    const Arena::Mark m = a.mark();
+    void *p = a.allocate(24, 16);
+
+    BOOST_TEST(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+    BOOST_TEST(a.rewind(m));
+    BOOST_TEST(a.allocate(24, 16) == p);
+
+    const Arena::Mark n = a.mark();
+    a.allocate(1, 1);
+    a.allocate(8, 8);
+
+    BOOST_TEST(!a.rewind(n));
+
+    begin_unit("test_case");
+    auto q = TETRAHEDRON(1, 1, 1);
+    discard_unit();
+
+    BOOST_TEST(q->describe() == "tetrahedron(1,1,1)");
+}
+
+// Tags should be of fixed size, regardless of the depth of the
+// graph, while descriptions should be spelled out in full.
+
+BOOST_AUTO_TEST_CASE(structural_tags)
+{
+    auto p = TETRAHEDRON(1, 1, 1);
+    auto q = CONVERT_TO<Nef_polyhedron>(CONVERT_TO<Surface_mesh>(p));
+    auto r = CONVERT_TO<Nef_polyhedron>(CONVERT_TO<Surface_mesh>(
+                                            TETRAHEDRON(1, 1, 1)));
+    auto s = CONVERT_TO<Surface_mesh>(p);
+
+    BOOST_TEST(q == r);
+    BOOST_TEST(p->get_tag() == "0d3bea0382f6d081210196427ff68fd6078e6310");
+    BOOST_TEST(s->get_tag() == sha1digest("mesh(#" + p->get_tag() + ")"));
+    BOOST_TEST(q->get_tag().size() == 40);
+    BOOST_TEST(q->describe() == "nef(mesh(tetrahedron(1,1,1)))");
+    BOOST_TEST(q->describe_structure() == "nef(#" + s->get_tag() + ")");
+    BOOST_TEST(q->kind() == "nef");
+}
+
+BOOST_AUTO_TEST_CASE(digest)
+{
+    BOOST_TEST(sha1digest("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    BOOST_TEST(
+        sha1digest("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    BOOST_TEST(
+        sha1digest(std::string(1'000'000, 'a'))
+        == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+    // Words are padded with leading zeros, unlike legacy digests.
+
+    BOOST_TEST(
+        sha1digest("tetrahedron(1,1,1)")
+        == "0d3bea0382f6d081210196427ff68fd6078e6310");
+    BOOST_TEST(
+        legacy_sha1digest("tetrahedron(1,1,1)")
+        == "d3bea0382f6d081210196427ff68fd678e6310");
+}
+
 BOOST_AUTO_TEST_CASE(misc_tags)
 {
     BOOST_TEST(compose_tag("x", 5) == "x(5)");
     BOOST_TEST(compose_tag("x", FT(FT::ET(5, 2))) == "x(5/2)");
+    BOOST_TEST(compose_tag("x", FT(0.625), -3) == "x(5/8,-3)");
+    BOOST_TEST(compose_tag("x", FT(1) / FT(3)) == "x(1/3)");
     BOOST_TEST(
         compose_tag("x", Point_2(3, FT(FT::ET(5, 2)))) == "x(point(3,5/2))");
     BOOST_TEST(
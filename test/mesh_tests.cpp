@@ -22,6 +22,7 @@
 #include <boost/test/data/monomorphic.hpp>
 
 #include <iostream>
+#include <sstream>
 
 #include "options.h"
 #include "kernel.h"
@@ -26,6 +26,7 @@
 
 #include <CGAL/draw_polygon_set_2.h>
 
+#include "options.h"
 #include "kernel.h"
 #include "transformations.h"
 #include "macros.h"
@@ -433,4 +434,26 @@ BOOST_DATA_TEST_CASE(offset,
     test_polygon(*p->get_value(), 1, 0, 4, l * l);
 }
 
+// Test parallel evaluation.  Polygon operations should be dispatched
+// to worker threads and yield the same results as when evaluated
+// serially.
+
+BOOST_FIXTURE_TEST_CASE(threads, Threads_guard)
+{
+    std::vector<std::shared_ptr<Polygon_operation<Polygon_set>>> v;
+
+    for (int i = 0; i < 16; i++) {
+        v.push_back(
+            JOIN(TRANSFORM(RECTANGLE(2, 2), TRANSLATION_2(i, 0)),
+                 TRANSFORM(RECTANGLE(4, 4), TRANSLATION_2(i + 2, 2))));
+    }
+
+    evaluate_unit();
+
+    for (const auto &p: v) {
+        BOOST_TEST(p->threadsafe);
+        test_polygon(*p->get_value(), 1, 0, 8, 19);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -23,11 +23,13 @@
 #include <boost/mpl/list.hpp>
 
 #include <filesystem>
+#include <sstream>
 
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
 #include <CGAL/Polygon_mesh_processing/triangulate_faces.h>
 #include <CGAL/Polygon_mesh_processing/measure.h>
 
+#include "options.h"
 #include "kernel.h"
 #include "transformations.h"
 #include "tolerances.h"
@@ -536,6 +538,33 @@ BOOST_DATA_TEST_CASE(extrude_many,
     }
 }
 
+// Test parallel evaluation of extrusions, both with and without
+// holes.
+
+BOOST_FIXTURE_TEST_CASE(extrude_threads, Threads_guard)
+{
+    std::vector<std::shared_ptr<Polyhedron_operation<Polyhedron>>> v;
+
+    for (int i = 0; i < 16; i++) {
+        auto a = TRANSFORM(
+            (i % 2 == 0 ? RECTANGLE(2, 2)
+                        : DIFFERENCE(RECTANGLE(2, 2), RECTANGLE(1, 1))),
+            TRANSLATION_2(i, 0));
+
+        v.push_back(
+            EXTRUSION(a, {TRANSLATION_3(0, 0, 0), TRANSLATION_3(0, 0, 1)}));
+    }
+
+    evaluate_unit();
+
+    for (int i = 0; i < 16; i++) {
+        BOOST_TEST_REQUIRE(CGAL::is_valid_polygon_mesh(*v[i]->get_value()));
+        BOOST_TEST_REQUIRE(CGAL::is_closed(*v[i]->get_value()));
+
+        test_polyhedron_volume(*v[i]->get_value(), FT(4 - i % 2));
+    }
+}
+
 /////////////////
 // Convex hull //
 /////////////////
@@ -73,9 +73,9 @@ static auto compare(T lambda)
         evaluate_unit();
 
         for (auto &[k, x]: _get_operations()) {
-            const std::string &l = x->get_tag();
+            const std::string l = x->get_tag();
             BOOST_TEST(l == k);
-            BOOST_TEST(l == x->describe());
+            BOOST_TEST(l == x->reset_tag());
         }
     }
 
@@ -23,6 +23,7 @@
 #include <filesystem>
 
 #include "assertions.h"
+#include "digest.h"
 #include "kernel.h"
 #include "macros.h"
 
@@ -240,4 +241,164 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(polygon, T, polygon_types)
     std::remove(a->annotations["stored"].c_str());
 }
 
+///////////////
+// Migration //
+///////////////
+
+// Operations stored under the legacy digest of their full description
+// should only be loaded when migrating the store, whereupon they
+// should be renamed.
+
+BOOST_AUTO_TEST_CASE(migration)
+{
+    int i = Options::store_threshold;
+    bool p = Flags::store_operations, q = Flags::load_operations;
+
+    Options::store_threshold = 0;
+    Flags::store_operations = true;
+
+    begin_unit("store");
+    auto s = TETRAHEDRON(1, 1, 1);
+    auto a = CONVERT_TO<Surface_mesh>(s);
+    evaluate_unit();
+
+    Flags::store_operations = p;
+
+    const std::filesystem::path u(a->annotations["stored"]);
+    const std::filesystem::path v(
+        legacy_sha1digest(a->describe()) + u.extension().string());
+
+    std::filesystem::rename(u, v);
+
+    Flags::load_operations = true;
+
+    for (int k = 0; k < 2; k++) {
+        Flags::migrate_store = k;
+
+        begin_unit("load");
+        auto b = CONVERT_TO<Surface_mesh>(TETRAHEDRON(1, 1, 1));
+        evaluate_unit();
+
+        BOOST_TEST((b->annotations.count("loaded") > 0) == (k > 0));
+    }
+
+    BOOST_TEST(std::filesystem::exists(u));
+    BOOST_TEST(!std::filesystem::exists(v));
+
+    Flags::migrate_store = 0;
+    Flags::load_operations = q;
+    Options::store_threshold = i;
+
+    std::filesystem::remove(u);
+    std::filesystem::remove(v);
+    std::remove(s->annotations["stored"].c_str());
+}
+
+////////////////////////
+// Background storing //
+////////////////////////
+
+// All stores should have concluded by the time evaluation does, and
+// results should not be released while their store is pending.  The
+// operations dump should reflect the stores.
+
+BOOST_AUTO_TEST_CASE(background)
+{
+    int i = Options::threads;
+    int j = Options::store_threshold;
+    int k = Options::io_threads;
+    int l = Flags::release_operations;
+    int m = Flags::dump_annotations;
+    bool p = Flags::store_operations;
+    const char *s = Options::dump_operations;
+
+    Options::threads = 2;
+    Options::store_threshold = 0;
+    Options::io_threads = 2;
+    Flags::release_operations = 1;
+    Flags::dump_annotations = 1;
+    Flags::store_operations = true;
+    Options::dump_operations = "";
+
+    begin_unit("store");
+    auto a = SPHERE(1);
+    auto b = CONVERT_TO<Surface_mesh>(a);
+    auto c = CONVERT_TO<Nef_polyhedron>(b);
+    evaluate_unit();
+
+    Options::threads = i;
+    Options::store_threshold = j;
+    Options::io_threads = k;
+    Flags::release_operations = l;
+    Flags::dump_annotations = m;
+    Flags::store_operations = p;
+    Options::dump_operations = s;
+
+    {
+        std::ifstream f("store.list");
+        int n = 0;
+
+        for (std::string t; std::getline(f, t);) {
+            n += (t.find("stored: ") != std::string::npos);
+        }
+
+        BOOST_TEST(n == 3);
+    }
+
+    std::filesystem::remove("store.list");
+
+    for (Operation *x: {static_cast<Operation *>(a.get()),
+                        static_cast<Operation *>(b.get()),
+                        static_cast<Operation *>(c.get())}) {
+        BOOST_TEST_REQUIRE((x->annotations.find("stored")
+                            != x->annotations.end()));
+
+        std::fstream f(x->annotations["stored"]);
+        BOOST_TEST(f.good());
+
+        std::remove(x->annotations["stored"].c_str());
+    }
+
+    BOOST_TEST(a->size() == 0);
+    BOOST_TEST(b->size() == 0);
+    BOOST_TEST(c->size() > 0);
+}
+
+// Loadable source operations should be loaded by the I/O threads,
+// and their successors evaluated as usual.
+
+BOOST_AUTO_TEST_CASE(prefetch)
+{
+    int i = Options::threads;
+    int j = Options::store_threshold;
+    bool p = Flags::store_operations;
+    bool q = Flags::load_operations;
+
+    Options::threads = 2;
+    Options::store_threshold = 0;
+
+    Flags::store_operations = true;
+    begin_unit("store");
+    auto a = SPHERE(1);
+    evaluate_unit();
+    Flags::store_operations = p;
+
+    Flags::load_operations = true;
+    begin_unit("load");
+    auto b = SPHERE(1);
+    auto c = CONVERT_TO<Surface_mesh>(b);
+    evaluate_unit();
+    Flags::load_operations = q;
+
+    Options::threads = i;
+    Options::store_threshold = j;
+
+    BOOST_TEST(b->annotations["loaded"] == a->annotations["stored"]);
+    BOOST_TEST(b->annotations["thread"] == "io");
+    BOOST_TEST(c->get_value()->number_of_vertices()
+               == a->get_value()->size_of_vertices());
+
+    std::remove(a->annotations["stored"].c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()